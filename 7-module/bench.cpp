@@ -0,0 +1,2504 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <forward_list>
+#include <fstream>
+#include <iostream>
+#include <list>
+#include <map>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <csignal>
+#include <dirent.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include "include/Logger.h"
+#include "include/BinaryLog.h"
+#include "include/JsonLog.h"
+#include "include/UringSink.h"
+#include "include/MmapSink.h"
+#include "include/RotatingSink.h"
+#include "include/CompressSink.h"
+#include "include/DurableSink.h"
+
+// 基准测试：每一项打印吞吐量，涉及格式变换的项先做一次正确性校验
+
+// 统计当前线程的堆分配次数，用于衡量热路径上的分配。
+// 替换函数不能内联：内联后 GCC 会把 new 出来的指针交给 free 当作不配对的释放（-Wmismatched-new-delete）
+thread_local uint64_t thread_allocations = 0;
+
+__attribute__((noinline)) void* operator new(size_t size) {
+    ++thread_allocations;
+    if (void* p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+__attribute__((noinline)) void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+__attribute__((noinline)) void operator delete(void* p, size_t) noexcept {
+    std::free(p);
+}
+
+template <typename F>
+double measure_seconds(F f) {
+    auto start = std::chrono::steady_clock::now();
+    f();
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double>(end - start).count();
+}
+
+std::string read_file(const std::string& filename) {
+    std::ifstream in(filename, std::ios::binary);
+    std::stringstream data;
+    data << in.rdbuf();
+    return data.str();
+}
+
+// 同一组日志同时写文本和二进制，解码后必须与文本逐字节一致
+// 解码不可信的数据：要么正常结束，要么抛出 runtime_error（含 fmt::format_error），不能越界或崩溃
+bool decode_untrusted(const std::string& data) {
+    try {
+        binary_log_reader reader(data);
+        std::string line;
+        while (reader.next(line)) {
+        }
+        return true;
+    } catch (const std::runtime_error&) {
+        return false;
+    }
+}
+
+// 截断和随机改写字节后的二进制日志都只能以异常结束；伪造的静态字符串参数必须被拒绝
+bool check_corrupt_binary_log(const std::string& data) {
+    std::string sample = data.substr(0, std::min<size_t>(data.size(), 8192));
+    for (size_t size = 0; size < sample.size(); ++size) {
+        decode_untrusted(sample.substr(0, size));
+    }
+    std::mt19937 rng(42);
+    for (int i = 0; i < 2000; ++i) {
+        std::string mutated = sample;
+        int flips = 1 + static_cast<int>(rng() % 4);
+        for (int j = 0; j < flips; ++j) {
+            size_t pos = sizeof(binary_log_magic) + 1 + rng() % (mutated.size() - sizeof(binary_log_magic) - 1);
+            mutated[pos] = static_cast<char>(rng());
+        }
+        decode_untrusted(mutated);
+    }
+
+    // 参数里的 static_string 是写入进程内的指针，来自文件时解码必须失败而不是去读这个地址
+    std::string forged(binary_log_magic, sizeof(binary_log_magic));
+    forged.push_back(static_cast<char>(binary_log_version));
+    forged += 'R';
+    put_varint(forged, 0);  // 调用点 id 0：格式串随记录写出
+    put_varint(forged, 1);  // tid
+    put_varint(forged, 0);  // logger id
+    put_varint(forged, 0);  // 时间差
+    forged.push_back(static_cast<char>(Logger::INFO));
+    put_bytes(forged, "{}");
+    std::string args(1, static_cast<char>(packed_type::static_string));
+    const char* address = reinterpret_cast<const char*>(0x1000);
+    uint32_t size = 16;
+    args.append(reinterpret_cast<const char*>(&address), sizeof(address));
+    args.append(reinterpret_cast<const char*>(&size), sizeof(size));
+    put_bytes(forged, args);
+    put_varint(forged, 0);  // 字段数
+    return !decode_untrusted(forged) && decode_untrusted(data);
+}
+
+bool check_binary_roundtrip() {
+    const std::string text_file = "bench_roundtrip.log";
+    const std::string binary_file = "bench_roundtrip.blog";
+    std::remove(text_file.c_str());
+    std::remove(binary_file.c_str());
+    {
+        auto logger = std::make_shared<Logger>();
+        auto text_sink = std::make_shared<file_sink>(text_file);
+        auto bin_sink = std::make_shared<binary_file_sink>(binary_file);
+        logger->add_sink(text_sink);
+        logger->add_sink(bin_sink);
+        std::string path = "/data/日志/路径";
+        for (int i = 0; i < 1000; ++i) {
+            LOG_INFO(logger, "请求 {} 完成，耗时 {:.3f} ms，路径 {}", i, i * 0.125, path);
+            LOG_WARNING(logger, "标志 {} 字符 {} 无符号 {} 负数 {:x}", i % 2 == 0, 'x', 4000000000u, -i);
+            LOG_ERROR(logger, "大整数 {} 浮点 {} 指针 {}", 1LL << 40, 0.1f, static_cast<const void*>(nullptr));
+            logger->log(Logger::INFO, "动态格式串 {} {}", i, "未找到");
+            LOG_KV_INFO(logger, log_fields(kv("user", path), kv("ms", i * 0.5), kv("ok", true)), "字段 {}", i);
+            logger->log(Logger::WARNING, log_fields(kv("code", 404)), "动态字段");
+        }
+        logger->set_name("app");
+        LOG_INFO(logger, "命名后 {}", 1);
+        LOG_ERROR(logger, "命名后 {}", 2);
+        logger->set_name("");
+        std::thread worker([&] {
+            LOG_INFO(logger, "工作线程改名前");
+            set_thread_name("worker");
+            LOG_INFO(logger, "工作线程改名后 {}", 1);
+        });
+        worker.join();
+        text_sink->flush();
+        bin_sink->flush();
+    }
+    // 第二次运行追加到同一个文件：新的文件头之后字典重新编号，logger id 1 不再是 "app"
+    {
+        auto logger = std::make_shared<Logger>();
+        logger->add_sink(std::make_shared<file_sink>(text_file));
+        logger->add_sink(std::make_shared<binary_file_sink>(binary_file));
+        logger->set_name("重启");
+        for (int i = 0; i < 10; ++i) {
+            LOG_INFO(logger, "重启后 {} {}", i, "追加");
+        }
+    }
+
+    std::string decoded;
+    binary_log_reader reader(read_file(binary_file));
+    std::string line;
+    while (reader.next(line)) {
+        decoded += line;
+    }
+    bool ok = decoded == read_file(text_file) && check_corrupt_binary_log(read_file(binary_file));
+    std::remove(text_file.c_str());
+    std::remove(binary_file.c_str());
+    return ok;
+}
+
+// 同一条带三个参数的消息分别写文本和二进制文件。-O2、单核上文本约 1.0M 条/秒，二进制约 2.5M–2.9M 条/秒，
+// 吞吐约 2–3 倍，体积约 39%。最初测得的 11–14 倍是和 ctime 文本路径比的，文本路径优化后已不成立
+void bench_binary_format() {
+    const int count = 1000000;
+    const std::string text_file = "bench_text.log";
+    const std::string binary_file = "bench_binary.blog";
+
+    if (!check_binary_roundtrip()) {
+        std::cerr << "二进制日志往返校验失败" << std::endl;
+        std::exit(1);
+    }
+
+    std::remove(text_file.c_str());
+    std::remove(binary_file.c_str());
+    auto run = [count](std::shared_ptr<Logger> logger) {
+        return measure_seconds([&] {
+            for (int i = 0; i < count; ++i) {
+                LOG_INFO(logger, "请求 {} 完成，耗时 {:.3f} ms，路径 {}", i, i * 0.125, "/api/v1/items");
+            }
+        });
+    };
+
+    double text_seconds, binary_seconds;
+    {
+        auto logger = std::make_shared<Logger>();
+        logger->add_sink(std::make_shared<file_sink>(text_file));
+        text_seconds = run(logger);
+    }
+    {
+        auto logger = std::make_shared<Logger>();
+        logger->add_sink(std::make_shared<binary_file_sink>(binary_file));
+        binary_seconds = run(logger);
+    }
+    size_t text_bytes = read_file(text_file).size();
+    size_t binary_bytes = read_file(binary_file).size();
+    std::remove(text_file.c_str());
+    std::remove(binary_file.c_str());
+
+    fmt::print("[binary] 文本:   {:>12.0f} 条/秒 {:>10} 字节\n", count / text_seconds, text_bytes);
+    fmt::print("[binary] 二进制: {:>12.0f} 条/秒 {:>10} 字节 (吞吐 {:.1f}x, 体积 {:.1f}%)\n",
+               count / binary_seconds, binary_bytes, text_seconds / binary_seconds,
+               100.0 * binary_bytes / text_bytes);
+}
+
+// 生产者端每条消息的取时开销，以及消费者端换算的精度与单调性
+void bench_clock_sources() {
+    const int count = 10000000;
+    const clock_source sources[] = {clock_source::realtime, clock_source::monotonic_raw, clock_source::tsc};
+    const char* names[] = {"realtime", "monotonic_raw", "tsc"};
+    for (int i = 0; i < 3; ++i) {
+        clock_source source = resolve_clock_source(sources[i]);
+        uint64_t sum = 0;
+        double seconds = measure_seconds([&] {
+            for (int n = 0; n < count; ++n) {
+                sum += capture_ticks(source);
+            }
+        });
+
+        // 4 个线程同时换算并跨过一次重新校准，检查换算误差和各线程内的单调性。
+        // 误差按换算结果落在前后两次 CLOCK_REALTIME 读数之外的距离计算
+        tick_converter& converter = tick_converter::instance();
+        converter.to_realtime_ns(source, capture_ticks(source));
+        const int threads = 4;
+        int64_t errors[threads] = {};
+        bool monotonic[threads];
+        int64_t start = clock_ns(CLOCK_REALTIME);
+        std::vector<std::thread> workers;
+        for (int t = 0; t < threads; ++t) {
+            workers.emplace_back([&, t] {
+                int64_t last = 0;
+                monotonic[t] = true;
+                for (;;) {
+                    int64_t before = clock_ns(CLOCK_REALTIME);
+                    uint64_t ticks = capture_ticks(source);
+                    int64_t after = clock_ns(CLOCK_REALTIME);
+                    if (after - start > tick_converter::refresh_ns * 3 / 2) {
+                        break;
+                    }
+                    int64_t converted = converter.to_realtime_ns(source, ticks);
+                    errors[t] = std::max(errors[t], std::max(before - converted, converted - after));
+                    monotonic[t] = monotonic[t] && converted >= last;
+                    last = converted;
+                }
+            });
+        }
+        for (auto& worker : workers) {
+            worker.join();
+        }
+        int64_t max_error = *std::max_element(errors, errors + threads);
+        bool all_monotonic = std::count(monotonic, monotonic + threads, true) == threads;
+
+        uint64_t ticks = capture_ticks(source);
+        int64_t converted_sum = 0;
+        double convert_seconds = measure_seconds([&] {
+            for (int n = 0; n < count; ++n) {
+                converted_sum += converter.to_realtime_ns(source, ticks + n);
+            }
+        });
+
+        fmt::print("[clock] {:<14} {:>6.2f} ns/次 换算 {:>5.2f} ns/次 最大误差 {:>8.3f} us {}{}\n", names[i],
+                   seconds * 1e9 / count, convert_seconds * 1e9 / count, max_error / 1000.0,
+                   all_monotonic ? "单调" : "非单调",
+                   source != sources[i] ? "（不支持，已退回 monotonic_raw）" : "");
+        if (converted_sum == 0) {
+            std::cerr << std::endl;
+        }
+        if (sum == 0) {
+            std::cerr << std::endl;
+        }
+    }
+}
+
+// 线程字段：缓存的 tid 标签 vs 每条消息调用 get_id() 并经 ostream 格式化。
+// 整行格式化的抖动远大于字段本身，这里只测字段的采集和拷贝，取 5 轮最小值
+template <typename F>
+double bench_thread_append(int count, F append_thread) {
+    fmt::memory_buffer buf;
+    double best = 1e9;
+    for (int round = 0; round < 5; ++round) {
+        best = std::min(best, measure_seconds([&] {
+            for (int i = 0; i < count; ++i) {
+                buf.clear();
+                append_thread(buf);
+            }
+        }));
+    }
+    return best * 1e9 / count;
+}
+
+void bench_thread_field() {
+    double cached = bench_thread_append(10000000, [](fmt::memory_buffer& buf) {
+        const std::string* field = this_thread_info().field.load(std::memory_order_relaxed);
+        size_t size = buf.size();
+        buf.resize(size + field->size());
+        std::memcpy(buf.data() + size, field->data(), field->size());
+    });
+    double naive = bench_thread_append(1000000, [](fmt::memory_buffer& buf) {
+        std::ostringstream os;
+        os << std::this_thread::get_id();
+        fmt::format_to(std::back_inserter(buf), "[{}] ", os.str());
+    });
+    fmt::print("[thread] 缓存标签 {:.2f} ns/条，get_id+ostream {:.2f} ns/条\n", cached, naive);
+}
+
+// 日志头：按秒缓存的时间加每个 logger 预先拼好的 "] [name] [LEVEL] "，
+// 对比每条都 ctime 加 "[{}] [{}] [{}] " 格式化
+class header_bench_logger : public Logger {
+public:
+    explicit header_bench_logger(const std::string& name) : Logger(name) {}
+
+    std::string cached_entry(LogLevel level, int64_t time_ns) {
+        return format_entry(make_msg(level), time_ns);
+    }
+
+    std::string naive_entry(LogLevel level, int64_t time_ns) {
+        log_msg msg = make_msg(level);
+        std::time_t now = static_cast<std::time_t>(time_ns / 1000000000);
+        fmt::memory_buffer buf;
+        fmt::format_to(std::back_inserter(buf), "[{}] [{}] [{}] ", currentDateTime(now), name(), toString(level));
+        fmt::string_view thread = thread_label(msg.stamp.thread_field);
+        fmt::format_to(std::back_inserter(buf), "[{}] ", thread);
+        fmt::vformat_to(std::back_inserter(buf), msg.format, msg.args);
+        buf.push_back('\n');
+        return fmt::to_string(buf);
+    }
+
+private:
+    log_msg make_msg(LogLevel level) {
+        return log_msg(nullptr, level, "请求完成", fmt::format_args(), log_stamp(clock_source::realtime));
+    }
+
+    // 临时的参数 store 不能用来构造 log_msg（语句结束后 args 悬空），具名的 store 可以
+    typedef decltype(fmt::make_format_args(std::declval<int&>())) int_store;
+    static_assert(!std::is_constructible<log_msg, const call_site*, LogLevel, fmt::string_view, int_store,
+                                         const log_stamp&>::value,
+                  "log_msg 不应接受临时的参数 store");
+    static_assert(std::is_constructible<log_msg, const call_site*, LogLevel, fmt::string_view, int_store&,
+                                        const log_stamp&>::value,
+                  "log_msg 应接受具名的参数 store");
+};
+
+bool check_header_cache() {
+    header_bench_logger logger("checkout");
+    int64_t time_ns = clock_ns(CLOCK_REALTIME);
+    for (int i = 0; i < 3000; ++i) {
+        Logger::LogLevel level = static_cast<Logger::LogLevel>(i % level_count);
+        int64_t t = time_ns + static_cast<int64_t>(i) * 7919000000LL;
+        if (logger.cached_entry(level, t) != logger.naive_entry(level, t)) {
+            return false;
+        }
+    }
+    logger.set_level_style(level_style::abbreviated);
+    return logger.cached_entry(Logger::WARNING, time_ns).find("] [checkout] [W] [") != std::string::npos;
+}
+
+void bench_header() {
+    if (!check_header_cache()) {
+        std::cerr << "日志头缓存校验失败" << std::endl;
+        std::exit(1);
+    }
+    const int count = 1000000;
+    header_bench_logger logger("checkout");
+    size_t bytes = 0;
+    double cached = measure_seconds([&] {
+        for (int i = 0; i < count; ++i) {
+            bytes += logger.cached_entry(static_cast<Logger::LogLevel>(i & 3), clock_ns(CLOCK_REALTIME)).size();
+        }
+    });
+    double naive = measure_seconds([&] {
+        for (int i = 0; i < count; ++i) {
+            bytes += logger.naive_entry(static_cast<Logger::LogLevel>(i & 3), clock_ns(CLOCK_REALTIME)).size();
+        }
+    });
+    fmt::print("[header] 预拼日志头 {:.1f} ns/行，ctime+格式化 {:.1f} ns/行 ({:.1f}x, {} 字节)\n",
+               cached * 1e9 / count, naive * 1e9 / count, naive / cached, bytes);
+}
+
+// JSON 行：json_formatter 直接写缓冲 vs 先 fmt::format 消息再手工转义拼接
+void bench_json() {
+    const int count = 1000000;
+    std::string user = "Mozilla/5.0 \"测试\"\t(X11; Linux x86_64)";
+    double ms = 12.75;
+    int id = 42;
+    auto store = fmt::make_format_args(id, user);
+    auto fields = log_fields(kv("user", user), kv("ms", ms), kv("status", 200));
+
+    packed_record rec;
+    rec.site_id = 0;
+    rec.level = 0;
+    rec.level_name = "INFO";
+    rec.format = "请求 {} 来自 {}";
+    rec.file = nullptr;
+    rec.line = 0;
+    rec.signature = nullptr;
+    rec.tid = this_thread_info().tid;
+    rec.thread_label = thread_label(this_thread_info().field.load());
+    rec.format_args = store;
+    rec.fields = fields.view();
+
+    json_formatter formatter;
+    fmt::memory_buffer buf;
+    double direct = measure_seconds([&] {
+        for (int i = 0; i < count; ++i) {
+            rec.time_ns = clock_ns(CLOCK_REALTIME);
+            buf.clear();
+            formatter.format(rec, buf);
+        }
+    });
+
+    auto escape = [](const std::string& str) {
+        std::string out;
+        json_escape(out, str);
+        return out;
+    };
+    std::string line;
+    double naive = measure_seconds([&] {
+        for (int i = 0; i < count; ++i) {
+            int64_t time_ns = clock_ns(CLOCK_REALTIME);
+            std::time_t t = static_cast<std::time_t>(time_ns / 1000000000);
+            std::tm tm;
+            gmtime_r(&t, &tm);
+            char ts[32];
+            std::strftime(ts, sizeof(ts), "%Y-%m-%dT%H:%M:%S", &tm);
+            std::string msg = fmt::format("请求 {} 来自 {}", id, user);
+            line = fmt::format("{{\"ts\":\"{}.{:06}Z\",\"level\":\"{}\",\"msg\":\"{}\",\"user\":\"{}\",\"ms\":{},\"status\":{}}}\n",
+                               ts, (time_ns % 1000000000) / 1000, "INFO", escape(msg), escape(user), ms, 200);
+        }
+    });
+    fmt::print("[json] 直接写缓冲 {:.0f} ns/条，format+转义拼接 {:.0f} ns/条\n",
+               direct * 1e9 / count, naive * 1e9 / count);
+}
+
+// 转义：SSE2/AVX2 查找与逐字节版本结果必须一致。随机串偏向包含需要转义的字节，
+// 长度覆盖 0 到跨越多个 32 字节块
+bool check_escape_fuzz() {
+    std::vector<std::pair<const char*, escape_scan_fn>> scans;
+#if defined(__x86_64__) || defined(__i386__)
+    scans.push_back(std::make_pair("sse2", find_escape_sse2));
+    if (__builtin_cpu_supports("avx2")) {
+        scans.push_back(std::make_pair("avx2", find_escape_avx2));
+    }
+#endif
+    scans.push_back(std::make_pair("dispatch", find_escape));
+
+    const unsigned char special[] = {0x00, 0x01, 0x1f, 0x20, '"', '\\', 0x7f, 0x80, 0xff, '\n', '\t'};
+    const escape_class* classes[] = {&json_escape_class, &control_escape_class};
+    std::mt19937 rng(12345);
+    std::string input;
+    for (int round = 0; round < 200000; ++round) {
+        input.resize(rng() % 200);
+        unsigned density = rng() % 64 + 1;
+        for (char& c : input) {
+            c = rng() % density == 0 ? static_cast<char>(special[rng() % sizeof(special)])
+                                     : static_cast<char>(rng() % 256);
+        }
+        for (const escape_class* cls : classes) {
+            std::string expected;
+            escape_to(expected, input, *cls, find_escape_scalar);
+            for (const auto& scan : scans) {
+                std::string actual;
+                escape_to(actual, input, *cls, scan.second);
+                if (actual != expected) {
+                    std::cerr << "转义结果不一致: " << scan.first << std::endl;
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+// 转义吞吐：干净的中英文混合文本和每 256 字节左右一处引号的文本
+void bench_escape() {
+    if (!check_escape_fuzz()) {
+        std::cerr << "转义校验失败" << std::endl;
+        std::exit(1);
+    }
+
+    std::string clean;
+    while (clean.size() < (1 << 20)) {
+        clean += "GET /api/v1/items?id=42 HTTP/1.1 Mozilla/5.0 (X11; Linux x86_64) 用户代理 路径 ";
+    }
+    std::string sparse = clean;
+    for (size_t i = 255; i < sparse.size(); i += 256) {
+        sparse[i] = '"';
+    }
+
+    std::vector<std::pair<const char*, escape_scan_fn>> scans;
+    scans.push_back(std::make_pair("scalar", find_escape_scalar));
+#if defined(__x86_64__) || defined(__i386__)
+    scans.push_back(std::make_pair("sse2", find_escape_sse2));
+    if (__builtin_cpu_supports("avx2")) {
+        scans.push_back(std::make_pair("avx2", find_escape_avx2));
+    }
+#endif
+    const int rounds = 200;
+    fmt::memory_buffer out;
+    out.reserve(clean.size() * 2);
+    for (const auto& scan : scans) {
+        double gbps[2];
+        const std::string* inputs[] = {&clean, &sparse};
+        for (int i = 0; i < 2; ++i) {
+            double seconds = measure_seconds([&] {
+                for (int r = 0; r < rounds; ++r) {
+                    out.clear();
+                    escape_to(out, *inputs[i], json_escape_class, scan.second);
+                }
+            });
+            gbps[i] = inputs[i]->size() * double(rounds) / seconds / 1e9;
+        }
+        fmt::print("[escape] {:<7} 干净文本 {:>6.2f} GB/s，稀疏转义 {:>6.2f} GB/s\n", scan.first, gbps[0], gbps[1]);
+    }
+}
+
+// UTF-8 校验：SSSE3/AVX2 与逐字节版本的判定必须一致，修复结果必须合法。
+// 随机串由 1~4 字节字符拼成，再随机改写、截断若干字节
+bool check_utf8_fuzz() {
+    std::vector<std::pair<const char*, utf8_validate_fn>> validators;
+#if defined(__x86_64__) || defined(__i386__)
+    validators.push_back(std::make_pair("ssse3", utf8_validate_ssse3));
+    if (__builtin_cpu_supports("avx2")) {
+        validators.push_back(std::make_pair("avx2", utf8_validate_avx2));
+    }
+#endif
+    validators.push_back(std::make_pair("dispatch", utf8_validate));
+
+    const char* chars[] = {"a", "\n", "\xc2\x80", "\xdf\xbf", "\xe4\xb8\xad", "\xe0\xa0\x80", "\xed\x9f\xbf",
+                           "\xef\xbf\xbd", "\xf0\x90\x80\x80", "\xf4\x8f\xbf\xbf"};
+    const unsigned char noise[] = {0x80, 0xbf, 0xc0, 0xc1, 0xe0, 0xed, 0xa0, 0xf0, 0xf4, 0xf5, 0xff, 0x90};
+    std::mt19937 rng(54321);
+    std::string input;
+    size_t invalid = 0;
+    for (int round = 0; round < 200000; ++round) {
+        input.clear();
+        size_t count = rng() % 80;
+        for (size_t i = 0; i < count; ++i) {
+            input += chars[rng() % (sizeof(chars) / sizeof(chars[0]))];
+        }
+        int edits = rng() % 3;
+        for (int i = 0; i < edits && !input.empty(); ++i) {
+            input[rng() % input.size()] = static_cast<char>(noise[rng() % sizeof(noise)]);
+        }
+        if (!input.empty() && rng() % 4 == 0) {
+            input.resize(rng() % input.size());
+        }
+
+        bool expected = utf8_validate_scalar(input.data(), input.size());
+        invalid += !expected;
+        for (const auto& validator : validators) {
+            if (validator.second(input.data(), input.size()) != expected) {
+                std::cerr << "UTF-8 校验结果不一致: " << validator.first << std::endl;
+                return false;
+            }
+        }
+        std::string repaired;
+        utf8_repair(repaired, input);
+        if (!utf8_validate_scalar(repaired.data(), repaired.size()) || (expected && repaired != input)) {
+            std::cerr << "UTF-8 修复结果错误" << std::endl;
+            return false;
+        }
+    }
+    return invalid > 0 && invalid < 200000;
+}
+
+// 合法文本的校验吞吐，与同样大小的 memcpy 对比
+void bench_utf8() {
+    if (!check_utf8_fuzz()) {
+        std::cerr << "UTF-8 校验失败" << std::endl;
+        std::exit(1);
+    }
+
+    std::string ascii, cjk;
+    while (ascii.size() < (1 << 20)) {
+        ascii += "GET /api/v1/items?id=42 HTTP/1.1 status=200 bytes=512 ";
+    }
+    while (cjk.size() < (1 << 20)) {
+        cjk += "错误代码：503。错误信息：服务不可用，请稍后重试。";
+    }
+
+    std::vector<std::pair<const char*, utf8_validate_fn>> validators;
+    validators.push_back(std::make_pair("scalar", utf8_validate_scalar));
+#if defined(__x86_64__) || defined(__i386__)
+    validators.push_back(std::make_pair("ssse3", utf8_validate_ssse3));
+    if (__builtin_cpu_supports("avx2")) {
+        validators.push_back(std::make_pair("avx2", utf8_validate_avx2));
+    }
+#endif
+    const int rounds = 200;
+    const std::string* inputs[] = {&ascii, &cjk};
+    std::vector<char> copy(std::max(ascii.size(), cjk.size()));
+    double memcpy_gbps[2];
+    for (int i = 0; i < 2; ++i) {
+        double seconds = measure_seconds([&] {
+            for (int r = 0; r < rounds; ++r) {
+                std::memcpy(copy.data(), inputs[i]->data(), inputs[i]->size());
+                asm volatile("" : : "r"(copy.data()) : "memory");
+            }
+        });
+        memcpy_gbps[i] = inputs[i]->size() * double(rounds) / seconds / 1e9;
+    }
+    fmt::print("[utf8] {:<7} ASCII {:>6.2f} GB/s，中文 {:>6.2f} GB/s\n", "memcpy", memcpy_gbps[0], memcpy_gbps[1]);
+    for (const auto& validator : validators) {
+        double gbps[2];
+        for (int i = 0; i < 2; ++i) {
+            bool ok = true;
+            double seconds = measure_seconds([&] {
+                for (int r = 0; r < rounds; ++r) {
+                    ok &= validator.second(inputs[i]->data(), inputs[i]->size());
+                }
+            });
+            if (!ok) {
+                std::cerr << "合法文本被判为不合法: " << validator.first << std::endl;
+                std::exit(1);
+            }
+            gbps[i] = inputs[i]->size() * double(rounds) / seconds / 1e9;
+        }
+        fmt::print("[utf8] {:<7} ASCII {:>6.2f} GB/s，中文 {:>6.2f} GB/s\n", validator.first, gbps[0], gbps[1]);
+    }
+
+    // 端到端：file_sink 打开修复后写合法的中文日志行，取 3 轮最小值
+    const std::string file = "bench_utf8.log";
+    const int count = 500000;
+    double best[2] = {1e9, 1e9};
+    for (int round = 0; round < 3; ++round) {
+        for (int repair = 0; repair < 2; ++repair) {
+            std::remove(file.c_str());
+            auto logger = std::make_shared<Logger>();
+            auto sink = std::make_shared<file_sink>(file);
+            sink->set_utf8_repair(repair != 0);
+            logger->add_sink(sink);
+            best[repair] = std::min(best[repair], measure_seconds([&] {
+                for (int i = 0; i < count; ++i) {
+                    LOG_ERROR(logger, "错误代码：{}。错误信息：{}", 503, "服务不可用，请稍后重试");
+                }
+            }));
+        }
+    }
+    std::remove(file.c_str());
+    fmt::print("[utf8] file_sink 修复关闭 {:.0f} ns/条，打开 {:.0f} ns/条 ({:+.1f}%)\n", best[0] * 1e9 / count,
+               best[1] * 1e9 / count, (best[1] / best[0] - 1) * 100);
+}
+
+// 模拟开销大的调试参数：序列化一份请求
+std::string dump_request(int id, int& calls) {
+    ++calls;
+    fmt::memory_buffer buf;
+    for (int i = 0; i < 64; ++i) {
+        fmt::format_to(std::back_inserter(buf), "header-{}: value-{}-{};", i, id, i * 31);
+    }
+    return fmt::to_string(buf);
+}
+
+// 延迟参数：级别或 sink 过滤不通过时不求值，通过时多个 sink 只求值一次，异步路径在生产者求值
+bool check_lazy_args() {
+    const std::string text_file = "bench_lazy.log";
+    const std::string json_file = "bench_lazy.json";
+    int calls = 0;
+    bool ok = true;
+    {
+        auto logger = std::make_shared<Logger>();
+        auto text_sink = std::make_shared<file_sink>(text_file);
+        auto json_sink = std::make_shared<json_file_sink>(json_file);
+        logger->add_sink(text_sink);
+        logger->add_sink(json_sink);
+
+        logger->log(Logger::DEBUG, "关闭 {}", lazy([&] { return dump_request(1, calls); }));
+        LOG_DEBUG(logger, "关闭 {}", dump_request(2, calls));
+        ok = ok && calls == 0;
+
+        logger->set_level(Logger::DEBUG);
+        text_sink->set_level(Logger::INFO);
+        json_sink->set_level(Logger::INFO);
+        logger->log(Logger::DEBUG, "sink 过滤 {}", lazy([&] { return dump_request(3, calls); }));
+        ok = ok && calls == 0;
+
+        json_sink->set_level(Logger::DEBUG);
+        text_sink->set_level(Logger::DEBUG);
+        logger->log(Logger::DEBUG, "两个 sink {:.10}", lazy([&] { return dump_request(4, calls); }));
+        ok = ok && calls == 1;
+        text_sink->flush();
+    }
+    ok = ok && read_file(text_file).find("两个 sink header-0: ") != std::string::npos;
+    {
+        auto logger = std::make_shared<AsyncLogger>();
+        logger->add_sink(std::make_shared<file_sink>(text_file));
+        std::thread::id producer = std::this_thread::get_id();
+        bool on_producer = false;
+        logger->log(Logger::ERROR, "异步 {}", lazy([&] {
+            on_producer = std::this_thread::get_id() == producer;
+            return dump_request(5, calls);
+        }));
+        ok = ok && calls == 2 && on_producer;
+    }
+    std::remove(text_file.c_str());
+    std::remove(json_file.c_str());
+    return ok;
+}
+
+// 去掉每行 "[time] [LEVEL] [thread] " 头部，只比较正文
+std::string strip_headers(const std::string& text) {
+    std::string bodies;
+    size_t begin = 0;
+    while (begin < text.size()) {
+        size_t end = text.find('\n', begin);
+        size_t body = begin;
+        for (int i = 0; i < 3; ++i) {
+            body = text.find("] ", body) + 2;
+        }
+        bodies.append(text, body, end + 1 - body);
+        begin = end + 1;
+    }
+    return bodies;
+}
+
+template <typename LoggerType>
+std::string log_custom_specs(const std::string& text_file, const std::string& binary_file, std::string& decoded) {
+    std::remove(text_file.c_str());
+    std::remove(binary_file.c_str());
+    {
+        auto logger = std::make_shared<LoggerType>();
+        logger->add_sink(std::make_shared<file_sink>(text_file));
+        logger->add_sink(std::make_shared<binary_file_sink>(binary_file));
+        std::vector<int> ids = {1, 2, 3, 4, 5};
+        const char packet[] = "0123456789";
+        auto code = lazy([] { return 255; });
+        auto ratio = lazy([] { return 3.14159; });
+        auto name = lazy([] { return std::string("svc"); });
+        for (int i = 0; i < 3; ++i) {
+            LOG_INFO(logger, "十六进制 {:x} 精度 {:.3f} 对齐 [{:>8}]", code, ratio, name);
+            LOG_INFO(logger, "动态宽度 [{:>{}}] 其后 {}", name, 6 + i, i);
+            LOG_INFO(logger, "显式编号 {1:#x} {0} {1}", i, code);
+            LOG_INFO(logger, "宽度精度 [{:*^{}.{}f}] 其后 {}", ratio, 12, i, "尾");
+            LOG_INFO(logger, "容器 {} 字节 {}", bounded(ids, 2), hex(packet, 4));
+            LOG_KV_INFO(logger, log_fields(kv("code", code)), "字段 {:>5}", name);
+            logger->log(Logger::WARNING, "动态格式串 {:08.2f} {:x}", ratio, code);
+        }
+    }
+    decoded.clear();
+    binary_log_reader reader(read_file(binary_file));
+    std::string line;
+    while (reader.next(line)) {
+        decoded += line;
+    }
+    std::string text = read_file(text_file);
+    std::remove(text_file.c_str());
+    std::remove(binary_file.c_str());
+    return text;
+}
+
+// 自定义类型参数带格式说明符时，异步和同步写出的正文相同，二进制日志也能还原
+bool check_custom_arg_specs() {
+    std::string sync_decoded, async_decoded;
+    std::string sync_text = log_custom_specs<Logger>("bench_specs.log", "bench_specs.blog", sync_decoded);
+    std::string async_text = log_custom_specs<AsyncLogger>("bench_specs.log", "bench_specs.blog", async_decoded);
+    std::string body = strip_headers(sync_text);
+    return std::count(sync_text.begin(), sync_text.end(), '\n') == 21 && body == strip_headers(async_text) &&
+           sync_decoded == sync_text && async_decoded == async_text &&
+           body.find("十六进制 ff 精度 3.142 对齐 [     svc]\n") != std::string::npos &&
+           body.find("动态宽度 [    svc] 其后 1\n") != std::string::npos &&
+           body.find("显式编号 0xff 2 255\n") != std::string::npos &&
+           body.find("宽度精度 [****3.1*****] 其后 尾\n") != std::string::npos &&
+           body.find("容器 [1, 2, ... (+3 more)] 字节 30313233\n") != std::string::npos &&
+           body.find("字段   svc code=255\n") != std::string::npos &&
+           body.find("动态格式串 00003.14 ff\n") != std::string::npos;
+}
+
+void bench_lazy() {
+    if (!check_lazy_args() || !check_custom_arg_specs()) {
+        std::cerr << "延迟参数校验失败" << std::endl;
+        std::exit(1);
+    }
+
+    const int count = 10000000;
+    auto logger = std::make_shared<Logger>();
+    logger->add_sink(std::make_shared<file_sink>("/dev/null"));
+    int calls = 0;
+    double lazy_seconds = measure_seconds([&] {
+        for (int i = 0; i < count; ++i) {
+            logger->log(Logger::DEBUG, "请求内容：{}", lazy([&] { return dump_request(i, calls); }));
+        }
+    });
+    double macro_seconds = measure_seconds([&] {
+        for (int i = 0; i < count; ++i) {
+            LOG_DEBUG(logger, "请求内容：{}", dump_request(i, calls));
+        }
+    });
+    const int eager_count = 100000;
+    double eager_seconds = measure_seconds([&] {
+        for (int i = 0; i < eager_count; ++i) {
+            logger->log(Logger::DEBUG, "请求内容：{}", dump_request(i, calls));
+        }
+    });
+    fmt::print("[lazy] 关闭的 DEBUG：lazy {:.2f} ns/条，宏 {:.2f} ns/条，直接传参 {:.0f} ns/条\n",
+               lazy_seconds * 1e9 / count, macro_seconds * 1e9 / count, eager_seconds * 1e9 / eager_count);
+}
+
+// 有上限的容器参数：元素个数和字节上限、map 写法，以及异步路径在生产者端就格式化
+bool check_bounded_range() {
+    std::vector<int> ten = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10};
+    std::vector<int> empty;
+    std::vector<std::string> words = {"aaaa", "bbbb", "cccc"};
+    std::map<std::string, int> counts = {{"a", 1}, {"b", 2}};
+    int raw[] = {7, 8, 9};
+    bool ok = fmt::format("{}", bounded(ten, 3)) == "[1, 2, 3, ... (+7 more)]" &&
+              fmt::format("{}", bounded(ten)) == "[1, 2, 3, 4, 5, 6, 7, 8, 9, 10]" &&
+              fmt::format("{}", bounded(empty)) == "[]" &&
+              fmt::format("{}", bounded(words, 64, 10)) == "[aaaa, bbbb, ... (+1 more)]" &&
+              fmt::format("{}", bounded(words, 64, 0)) == "[... (+3 more)]" &&
+              fmt::format("{}", bounded(counts, 1)) == "{a: 1, ... (+1 more)}" &&
+              fmt::format("{}", bounded(raw, 2)) == "[7, 8, ... (+1 more)]";
+
+    // list 用 size() 报告剩余个数；forward_list 没有 size()，只报告还有剩余，不走到末尾
+    std::list<int> linked(ten.begin(), ten.end());
+    std::forward_list<int> forward(ten.begin(), ten.end());
+    std::forward_list<int> forward_short = {1, 2};
+    ok = ok && fmt::format("{}", bounded(linked, 3)) == "[1, 2, 3, ... (+7 more)]" &&
+         fmt::format("{}", bounded(forward, 3)) == "[1, 2, 3, ... (+more)]" &&
+         fmt::format("{}", bounded(forward, 0)) == "[... (+more)]" &&
+         fmt::format("{}", bounded(forward_short, 2)) == "[1, 2]" &&
+         fmt::format("{}", bounded(forward)) == "[1, 2, 3, 4, 5, 6, 7, 8, 9, 10]";
+
+    const std::string text_file = "bench_bounded.log";
+    std::remove(text_file.c_str());
+    {
+        auto logger = std::make_shared<AsyncLogger>();
+        logger->add_sink(std::make_shared<file_sink>(text_file));
+        std::vector<int> ids(1000000, 42);
+        LOG_INFO(logger, "候选 {}", bounded(ids, 2));
+        ids.clear();
+        ids.shrink_to_fit();
+    }
+    ok = ok && read_file(text_file).find("候选 [42, 42, ... (+999998 more)]\n") != std::string::npos;
+    std::remove(text_file.c_str());
+    return ok;
+}
+
+void bench_bounded_range() {
+    if (!check_bounded_range()) {
+        std::cerr << "有上限的容器参数校验失败" << std::endl;
+        std::exit(1);
+    }
+
+    auto logger = std::make_shared<Logger>();
+    logger->add_sink(std::make_shared<file_sink>("/dev/null"));
+    for (size_t size : {100, 10000, 1000000}) {
+        std::vector<int> ids(size);
+        for (size_t i = 0; i < size; ++i) {
+            ids[i] = static_cast<int>(i);
+        }
+        const int count = size >= 1000000 ? 20 : 2000;
+        size_t bytes = 0;
+        double full = measure_seconds([&] {
+            for (int i = 0; i < count; ++i) {
+                bytes += fmt::format("{}", ids).size();
+            }
+        });
+        const int bounded_count = 200000;
+        size_t bounded_bytes = 0;
+        double capped = measure_seconds([&] {
+            for (int i = 0; i < bounded_count; ++i) {
+                bounded_bytes += fmt::format("{}", bounded(ids)).size();
+            }
+        });
+        double logged = measure_seconds([&] {
+            for (int i = 0; i < bounded_count; ++i) {
+                LOG_INFO(logger, "候选 {}", bounded(ids));
+            }
+        });
+        fmt::print("[bounded] {:>7} 个元素：全量 {:>10.0f} ns/次 {:>8} 字节，bounded {:>5.0f} ns/次 {:>4} 字节，"
+                   "写日志 {:>5.0f} ns/条\n",
+                   size, full * 1e9 / count, bytes / count, capped * 1e9 / bounded_count,
+                   bounded_bytes / bounded_count, logged * 1e9 / bounded_count);
+    }
+
+    // 非随机访问的容器：耗时只取决于上限，与元素个数无关
+    for (size_t size : {100, 1000000}) {
+        std::list<int> linked;
+        std::forward_list<int> forward;
+        for (size_t i = 0; i < size; ++i) {
+            linked.push_back(static_cast<int>(i));
+            forward.push_front(static_cast<int>(i));
+        }
+        const int bounded_count = 200000;
+        double list_seconds = measure_seconds([&] {
+            for (int i = 0; i < bounded_count; ++i) {
+                LOG_INFO(logger, "候选 {}", bounded(linked));
+            }
+        });
+        double forward_seconds = measure_seconds([&] {
+            for (int i = 0; i < bounded_count; ++i) {
+                LOG_INFO(logger, "候选 {}", bounded(forward));
+            }
+        });
+        fmt::print("[bounded] {:>7} 个元素：list 写日志 {:>5.0f} ns/条，forward_list 写日志 {:>5.0f} ns/条\n", size,
+                   list_seconds * 1e9 / bounded_count, forward_seconds * 1e9 / bounded_count);
+    }
+}
+
+// 十六进制：各实现与逐字节版本一致，canonical 写法与 hexdump -C -v 一致，超过上限时截断
+bool check_hex_dump() {
+    std::vector<hex_encode_fn> impls = {hex_encode_scalar};
+#if defined(__x86_64__) || defined(__i386__)
+    if (__builtin_cpu_supports("ssse3")) {
+        impls.push_back(hex_encode_ssse3);
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        impls.push_back(hex_encode_avx2);
+    }
+#endif
+    std::mt19937 rng(39);
+    for (int round = 0; round < 2000; ++round) {
+        std::vector<unsigned char> data(rng() % 200);
+        for (auto& c : data) {
+            c = static_cast<unsigned char>(rng());
+        }
+        std::string expected;
+        for (unsigned char c : data) {
+            expected += fmt::format("{:02x}", c);
+        }
+        for (hex_encode_fn encode : impls) {
+            std::string out;
+            hex_to(out, data.data(), data.size(), hex_layout::compact, SIZE_MAX, encode);
+            if (out != expected) {
+                return false;
+            }
+        }
+    }
+
+    const char packet[] = "0123456789abcdef\n\tAB\x7f\x80 ~";
+    size_t size = sizeof(packet) - 1;
+    bool ok = fmt::format("{}", hexdump(packet, size)) ==
+                  "00000000  30 31 32 33 34 35 36 37  38 39 61 62 63 64 65 66  |0123456789abcdef|\n"
+                  "00000010  0a 09 41 42 7f 80 20 7e                           |..AB.. ~|\n"
+                  "00000018" &&
+              fmt::format("{}", hex(packet, size, 4)) == "30313233... (+20 bytes)" &&
+              fmt::format("{}", hexdump(packet, size, 0)) == "00000000\n... (+24 bytes)" &&
+              fmt::format("{}", hex(packet, 0)) == "";
+
+    const std::string text_file = "bench_hex.log";
+    std::remove(text_file.c_str());
+    {
+        auto logger = std::make_shared<AsyncLogger>();
+        logger->add_sink(std::make_shared<file_sink>(text_file));
+        std::string payload = "\x0a\x0b\xff";
+        logger->log_hex(Logger::INFO, "收到", payload.data(), payload.size());
+        payload.assign(3, 'x');
+    }
+    ok = ok && read_file(text_file).find("收到 (3 字节) 0a0bff\n") != std::string::npos;
+    std::remove(text_file.c_str());
+    return ok;
+}
+
+void bench_hex_dump() {
+    if (!check_hex_dump()) {
+        std::cerr << "十六进制输出校验失败" << std::endl;
+        std::exit(1);
+    }
+
+    std::vector<unsigned char> data(1 << 20);
+    std::mt19937 rng(39);
+    for (auto& c : data) {
+        c = static_cast<unsigned char>(rng());
+    }
+    std::string out;
+    out.reserve(data.size() * 5);
+    auto gbps = [&](int rounds, std::function<void()> f) {
+        double seconds = measure_seconds([&] {
+            for (int i = 0; i < rounds; ++i) {
+                out.clear();
+                f();
+            }
+        });
+        return rounds * data.size() / seconds / 1e9;
+    };
+    auto compact = [&](hex_encode_fn encode) {
+        return [&, encode] { hex_to(out, data.data(), data.size(), hex_layout::compact, SIZE_MAX, encode); };
+    };
+    double scalar = gbps(200, compact(hex_encode_scalar));
+    double fast = gbps(200, compact(hex_encode));
+    double canonical = gbps(100, [&] { hex_to(out, data.data(), data.size(), hex_layout::canonical); });
+    double naive = gbps(5, [&] {
+        for (unsigned char c : data) {
+            out += fmt::format("{:02x}", c);
+        }
+    });
+    fmt::print("[hex] 紧凑：逐字节 {:.2f} GB/s，SIMD {:.2f} GB/s；canonical {:.2f} GB/s；"
+               "fmt::format(\"{{:02x}}\") 逐字节 {:.3f} GB/s\n", scalar, fast, canonical, naive);
+}
+
+// 同步路径的并发扩展：正文在锁外的线程本地缓冲里格式化，
+// 对比整个 write_to_sinks 都在一把锁里（改动前 sink_it 持有 log_mutex 的做法）
+class serial_logger : public Logger {
+protected:
+    void sink_it(const log_msg& msg) override {
+        std::lock_guard<std::mutex> lock(serial_mutex_);
+        write_to_sinks(msg);
+    }
+
+private:
+    std::mutex serial_mutex_;
+};
+
+double run_sync_threads(std::shared_ptr<Logger> logger, int threads, int per_thread) {
+    return measure_seconds([&] {
+        std::vector<std::thread> workers;
+        for (int t = 0; t < threads; ++t) {
+            workers.emplace_back([&logger, per_thread, t] {
+                std::string path = "/api/v1/items";
+                for (int i = 0; i < per_thread; ++i) {
+                    LOG_INFO(logger, "请求 {} 完成，耗时 {:.3f} ms，路径 {}，线程 {}", i, i * 0.125, path, t);
+                }
+            });
+        }
+        for (auto& worker : workers) {
+            worker.join();
+        }
+    });
+}
+
+void bench_sync_threads() {
+    const int total = 400000;
+    // 移出临界区的正是这部分：单线程下正文格式化的开销
+    const int format_count = 1000000;
+    std::string path = "/api/v1/items";
+    fmt::memory_buffer body;
+    double format_seconds = measure_seconds([&] {
+        for (int i = 0; i < format_count; ++i) {
+            body.clear();
+            fmt::format_to(std::back_inserter(body), "请求 {} 完成，耗时 {:.3f} ms，路径 {}，线程 {}", i, i * 0.125, path, 0);
+        }
+    });
+    fmt::print("[sync] 硬件线程数 {}，移到锁外的正文格式化 {:.0f} ns/条\n", std::thread::hardware_concurrency(),
+               format_seconds * 1e9 / format_count);
+    for (int threads : {1, 2, 4, 8, 16, 32}) {
+        auto unlocked = std::make_shared<Logger>();
+        unlocked->add_sink(std::make_shared<file_sink>("/dev/null"));
+        auto serial = std::make_shared<serial_logger>();
+        serial->add_sink(std::make_shared<file_sink>("/dev/null"));
+        double parallel_seconds = run_sync_threads(unlocked, threads, total / threads);
+        double serial_seconds = run_sync_threads(serial, threads, total / threads);
+        fmt::print("[sync] {:>2} 线程：锁外格式化 {:>10.0f} 条/秒，锁内格式化 {:>10.0f} 条/秒 ({:.2f}x)\n", threads,
+                   total / parallel_seconds, total / serial_seconds, serial_seconds / parallel_seconds);
+    }
+}
+
+// 改动前基于 std::ofstream 的 file_helper，作为吞吐对照
+class ofstream_file_helper {
+public:
+    void open(const std::string& filename, bool truncate = false) {
+        std::ios_base::openmode mode = std::ios_base::out | std::ios_base::binary;
+        mode |= truncate ? std::ios_base::trunc : std::ios_base::app;
+        file_stream_.open(filename, mode);
+        if (!file_stream_.is_open()) {
+            throw std::runtime_error("无法打开文件：" + filename);
+        }
+    }
+
+    void write(const std::string& msg) {
+        file_stream_ << msg;
+    }
+
+    void flush() {
+        file_stream_.flush();
+    }
+
+private:
+    std::ofstream file_stream_;
+};
+
+void on_alarm(int) {}
+
+// 写入内容与预期逐字节一致：缓冲边界、超过缓冲的大块、不缓冲；
+// 再用管道加不带 SA_RESTART 的定时信号制造 EINTR 和部分写入
+bool check_file_helper() {
+    const std::string filename = "bench_file_helper.log";
+    std::mt19937 rng(41);
+    bool ok = true;
+    for (size_t buffer_size : {size_t(0), size_t(100), size_t(4096)}) {
+        std::string expected;
+        {
+            file_helper helper(buffer_size);
+            helper.open(filename, true);
+            for (int i = 0; i < 2000; ++i) {
+                std::string chunk(rng() % (i % 50 == 0 ? 10000 : 150), static_cast<char>('a' + i % 26));
+                helper.write(chunk);
+                expected += chunk;
+            }
+        }
+        ok = ok && read_file(filename) == expected;
+    }
+    std::remove(filename.c_str());
+
+    int fds[2];
+    if (pipe(fds) != 0) {
+        return false;
+    }
+    struct sigaction action;
+    std::memset(&action, 0, sizeof(action));
+    action.sa_handler = on_alarm;
+    struct sigaction old_action;
+    sigaction(SIGALRM, &action, &old_action);
+    sigset_t alarm_set;
+    sigemptyset(&alarm_set);
+    sigaddset(&alarm_set, SIGALRM);
+    pthread_sigmask(SIG_BLOCK, &alarm_set, nullptr);
+    std::string received;
+    std::thread reader([&] {
+        char buf[4096];
+        ssize_t n;
+        while ((n = read(fds[0], buf, sizeof(buf))) != 0) {
+            if (n > 0) {
+                received.append(buf, n);
+                std::this_thread::sleep_for(std::chrono::microseconds(20));
+            }
+        }
+    });
+    pthread_sigmask(SIG_UNBLOCK, &alarm_set, nullptr);
+    struct itimerval timer = {{0, 500}, {0, 500}};
+    setitimer(ITIMER_REAL, &timer, nullptr);
+    std::string expected;
+    for (int i = 0; i < 64; ++i) {
+        expected.append(64 * 1024, static_cast<char>('A' + i % 26));
+    }
+    {
+        file_helper helper(1 << 20);
+        helper.open("/proc/self/fd/" + std::to_string(fds[1]));
+        helper.write(expected);
+    }
+    struct itimerval stop = {{0, 0}, {0, 0}};
+    setitimer(ITIMER_REAL, &stop, nullptr);
+    sigaction(SIGALRM, &old_action, nullptr);
+    close(fds[1]);
+    reader.join();
+    close(fds[0]);
+    return ok && received == expected;
+}
+
+template <typename Helper>
+double bench_file_writes(Helper& helper, const std::vector<std::string>& lines, int rounds) {
+    return measure_seconds([&] {
+        for (int r = 0; r < rounds; ++r) {
+            for (const std::string& line : lines) {
+                helper.write(line);
+            }
+        }
+        helper.flush();
+    });
+}
+
+void bench_file_helper() {
+    if (!check_file_helper()) {
+        std::cerr << "file_helper 校验失败" << std::endl;
+        std::exit(1);
+    }
+
+    const std::string filename = "bench_file_helper.log";
+    std::vector<std::string> lines;
+    std::mt19937 rng(41);
+    size_t bytes = 0;
+    for (int i = 0; i < 10000; ++i) {
+        lines.push_back(fmt::format("[Sun Oct 18 09:53:15 2026] [INFO] [6857:main] 请求 {} 完成，耗时 {} ms{}\n", i,
+                                    rng() % 1000, std::string(rng() % 64, 'x')));
+        bytes += lines.back().size();
+    }
+    const int rounds = 100;
+    auto report = [&](const char* name, double seconds) {
+        fmt::print("[file] {:<16} {:>10.0f} 行/秒 {:>8.0f} MB/s\n", name, rounds * lines.size() / seconds,
+                   rounds * bytes / seconds / 1e6);
+        std::remove(filename.c_str());
+    };
+    {
+        ofstream_file_helper helper;
+        helper.open(filename, true);
+        report("ofstream", bench_file_writes(helper, lines, rounds));
+    }
+    for (size_t buffer_size : {size_t(0), size_t(64 * 1024), size_t(256 * 1024), size_t(1024 * 1024)}) {
+        file_helper helper(buffer_size);
+        helper.open(filename, true);
+        double seconds = bench_file_writes(helper, lines, buffer_size == 0 ? rounds / 10 : rounds);
+        if (buffer_size == 0) {
+            seconds *= 10;
+        }
+        report(fmt::format("fd 缓冲 {} KB", buffer_size / 1024).c_str(), seconds);
+    }
+}
+
+// 分片写入：日志头和正文不拼接，放不进缓冲的记录连同已缓冲的数据一次 writev。
+// 对照 sink 关闭分片，走拼好整行再 write 的路径
+class joined_file_sink : public file_sink {
+public:
+    joined_file_sink(const std::string& filename, size_t buffer_size = file_helper::default_buffer_size)
+        : file_sink(filename, buffer_size) {}
+
+    bool fragments() const override { return false; }
+};
+
+bool check_fragments() {
+    const std::string fragment_file = "bench_fragments.log";
+    const std::string joined_file = "bench_joined.log";
+    const std::string repair_file = "bench_repair.log";
+    std::remove(fragment_file.c_str());
+    std::remove(joined_file.c_str());
+    std::remove(repair_file.c_str());
+    {
+        auto logger = std::make_shared<Logger>("writev");
+        logger->add_sink(std::make_shared<file_sink>(fragment_file, 256));
+        logger->add_sink(std::make_shared<joined_file_sink>(joined_file, 256));
+        auto repair_sink = std::make_shared<file_sink>(repair_file);
+        repair_sink->set_utf8_repair(true);
+        logger->add_sink(repair_sink);
+        std::mt19937 rng(42);
+        for (int i = 0; i < 500; ++i) {
+            std::string payload(rng() % (i % 10 == 0 ? 100000 : 300), static_cast<char>('a' + i % 26));
+            LOG_KV_INFO(logger, log_fields(kv("i", i)), "消息 {} {}", i, payload);
+        }
+        // 不合法的片段拼成整行修复，其余片段原样写出
+        LOG_INFO(logger, "坏字节 {}", std::string("a\xff" "b"));
+    }
+    std::string fragments = read_file(fragment_file);
+    std::string repaired = fragments;
+    size_t bad = repaired.find("a\xff" "b");
+    if (bad != std::string::npos) {
+        repaired.replace(bad + 1, 1, "\xef\xbf\xbd");
+    }
+    bool ok = !fragments.empty() && fragments == read_file(joined_file) && bad != std::string::npos &&
+              repaired == read_file(repair_file);
+    std::remove(fragment_file.c_str());
+    std::remove(joined_file.c_str());
+    std::remove(repair_file.c_str());
+    return ok;
+}
+
+void bench_fragments() {
+    if (!check_fragments()) {
+        std::cerr << "分片写入校验失败" << std::endl;
+        std::exit(1);
+    }
+
+    const std::string filename = "bench_writev.log";
+    const size_t volume = 128 << 20;
+    for (size_t size : {size_t(100), size_t(4096), size_t(64 * 1024), size_t(1 << 20)}) {
+        std::string payload(size, 'x');
+        int count = static_cast<int>(volume / size);
+        auto run = [&](std::shared_ptr<base_sink> sink) {
+            auto logger = std::make_shared<Logger>();
+            logger->add_sink(sink);
+            double seconds = measure_seconds([&] {
+                for (int i = 0; i < count; ++i) {
+                    LOG_INFO(logger, "{}", payload);
+                }
+                sink->flush();
+            });
+            std::remove(filename.c_str());
+            return seconds;
+        };
+        double joined = run(std::make_shared<joined_file_sink>(filename));
+        double fragmented = run(std::make_shared<file_sink>(filename));
+        fmt::print("[writev] 正文 {:>7} 字节：拼接后 write {:>6.0f} MB/s，分片 writev {:>6.0f} MB/s ({:.2f}x)\n", size,
+                   volume / joined / 1e6, volume / fragmented / 1e6, joined / fragmented);
+    }
+}
+
+// io_uring sink 与 file_sink 逐字节一致：追加到已有文件、记录跨缓冲、超过单个缓冲的大记录；
+// 强制退回 write(2) 的路径也要一致
+bool check_uring_sink() {
+    const std::string expected_file = "bench_uring_expected.log";
+    const std::string uring_file = "bench_uring.log";
+    bool ok = true;
+    for (bool use_uring : {true, false}) {
+        for (const std::string& file : {expected_file, uring_file}) {
+            std::ofstream(file, std::ios::binary | std::ios::trunc) << "已有内容\n";
+        }
+        {
+            auto logger = std::make_shared<Logger>("uring");
+            logger->add_sink(std::make_shared<file_sink>(expected_file));
+            auto sink = std::make_shared<uring_file_sink>(uring_file, 3, 4096, use_uring);
+            logger->add_sink(sink);
+            std::mt19937 rng(43);
+            for (int i = 0; i < 3000; ++i) {
+                std::string payload(rng() % (i % 100 == 0 ? 20000 : 200), static_cast<char>('a' + i % 26));
+                LOG_INFO(logger, "消息 {} {}", i, payload);
+                if (i % 1000 == 999) {
+                    sink->flush();
+                }
+            }
+        }
+        ok = ok && read_file(expected_file) == read_file(uring_file);
+    }
+    std::remove(expected_file.c_str());
+    std::remove(uring_file.c_str());
+    return ok;
+}
+
+void bench_uring_sink() {
+    if (!check_uring_sink()) {
+        std::cerr << "io_uring sink 校验失败" << std::endl;
+        std::exit(1);
+    }
+
+    const int count = 1000000;
+    std::string path = "/api/v1/items";
+    auto run = [&](const std::string& filename, std::shared_ptr<base_sink> sink, double& max_us) {
+        auto logger = std::make_shared<Logger>();
+        logger->add_sink(sink);
+        max_us = 0;
+        double seconds = measure_seconds([&] {
+            for (int i = 0; i < count; ++i) {
+                auto start = std::chrono::steady_clock::now();
+                LOG_INFO(logger, "请求 {} 完成，耗时 {} ms，路径 {}", i, i % 1000, path);
+                double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+                max_us = us > max_us ? us : max_us;
+            }
+            sink->flush();
+        });
+        std::remove(filename.c_str());
+        return seconds;
+    };
+    bool available = uring_file_sink("bench_uring_probe.log").using_uring();
+    std::remove("bench_uring_probe.log");
+    for (const std::string& dir : {std::string("/dev/shm"), std::string(".")}) {
+        std::string filename = dir + "/bench_uring.log";
+        double write_max, uring_max;
+        double write_seconds = run(filename, std::make_shared<file_sink>(filename, uring_file_sink::default_buffer_size),
+                                   write_max);
+        double uring_seconds = run(filename, std::make_shared<uring_file_sink>(filename), uring_max);
+        fmt::print("[uring] {:<8} write(2) {:>8.0f} 条/秒 最长 {:>6.0f} us，io_uring{} {:>8.0f} 条/秒 最长 {:>6.0f} us\n",
+                   dir, count / write_seconds, write_max, available ? "" : "(已退回 write)", count / uring_seconds,
+                   uring_max);
+    }
+}
+
+// 映射 sink 与 file_sink 逐字节一致：追加到已有文件、跨窗口、超过一个窗口的大记录，
+// 关闭后文件大小等于实际写入的长度（预分配的尾部已截掉）
+bool check_mmap_sink() {
+    const std::string expected_file = "bench_mmap_expected.log";
+    const std::string mmap_file = "bench_mmap.log";
+    bool ok = true;
+    for (msync_policy policy : {msync_policy::none, msync_policy::async, msync_policy::sync}) {
+        for (const std::string& file : {expected_file, mmap_file}) {
+            std::ofstream(file, std::ios::binary | std::ios::trunc) << "已有内容\n";
+        }
+        {
+            auto logger = std::make_shared<Logger>("mmap");
+            logger->add_sink(std::make_shared<file_sink>(expected_file));
+            auto sink = std::make_shared<mmap_file_sink>(mmap_file, 64 * 1024, policy);
+            logger->add_sink(sink);
+            std::mt19937 rng(44);
+            for (int i = 0; i < 3000; ++i) {
+                std::string payload(rng() % (i % 500 == 0 ? 200000 : 200), static_cast<char>('a' + i % 26));
+                LOG_INFO(logger, "消息 {} {}", i, payload);
+                if (i % 1000 == 999) {
+                    sink->flush();
+                }
+            }
+        }
+        ok = ok && read_file(expected_file) == read_file(mmap_file);
+    }
+    std::remove(expected_file.c_str());
+    std::remove(mmap_file.c_str());
+    return ok;
+}
+
+void bench_mmap_sink() {
+    if (!check_mmap_sink()) {
+        std::cerr << "映射文件 sink 校验失败" << std::endl;
+        std::exit(1);
+    }
+
+    const int count = 2000000;
+    std::string path = "/api/v1/items";
+    auto run = [&](const std::string& filename, std::shared_ptr<base_sink> sink) {
+        std::remove(filename.c_str());
+        double seconds;
+        {
+            auto logger = std::make_shared<Logger>();
+            logger->add_sink(sink);
+            sink.reset();
+            seconds = measure_seconds([&] {
+                for (int i = 0; i < count; ++i) {
+                    LOG_INFO(logger, "请求 {} 完成，耗时 {} ms，路径 {}", i, i % 1000, path);
+                }
+                logger.reset();
+            });
+        }
+        std::remove(filename.c_str());
+        return count / seconds;
+    };
+    std::vector<std::string> lines;
+    size_t bytes = 0;
+    for (int i = 0; i < 10000; ++i) {
+        lines.push_back(fmt::format("[Sun Oct 18 09:53:15 2026] [INFO] [6857:main] 请求 {} 完成，耗时 {} ms\n", i, i % 1000));
+        bytes += lines.back().size();
+    }
+    const int rounds = 200;
+    for (const std::string& dir : {std::string("/dev/shm"), std::string(".")}) {
+        std::string filename = dir + "/bench_mmap.log";
+        double helper_seconds, mmap_seconds;
+        {
+            file_helper helper;
+            helper.open(filename, true);
+            helper_seconds = bench_file_writes(helper, lines, rounds);
+        }
+        {
+            mmap_file_helper helper;
+            helper.open(filename, true);
+            mmap_seconds = bench_file_writes(helper, lines, rounds);
+        }
+        std::remove(filename.c_str());
+        fmt::print("[mmap] {:<8} 只测写入：write(2) 64KB 缓冲 {:>6.0f} MB/s，mmap {:>6.0f} MB/s\n", dir,
+                   rounds * bytes / helper_seconds / 1e6, rounds * bytes / mmap_seconds / 1e6);
+        double buffered = run(filename, std::make_shared<file_sink>(filename));
+        double mapped = run(filename, std::make_shared<mmap_file_sink>(filename));
+        double mapped_async = run(filename, std::make_shared<mmap_file_sink>(
+            filename, mmap_file_helper::default_window_size, msync_policy::async));
+        fmt::print("[mmap] {:<8} write(2) 64KB 缓冲 {:>8.0f} 条/秒，mmap {:>8.0f} 条/秒，mmap+MS_ASYNC {:>8.0f} 条/秒\n",
+                   dir, buffered, mapped, mapped_async);
+    }
+}
+
+// 滚动：文件数量和大小符合上限，按 log.3、log.2、log.1、log 的顺序拼起来正好是最后写入的那些记录；
+// 启动时计入已有文件的大小
+bool check_rotating_sink() {
+    const std::string filename = "bench_rotating.log";
+    const size_t max_files = 3;
+    const uint64_t max_size = 1000;
+    bool ok = true;
+    for (bool background : {true, false}) {
+        for (size_t i = 0; i <= max_files + 1; ++i) {
+            std::remove(rotating_file_sink::rotated_name(filename, i).c_str());
+        }
+        std::ofstream(filename, std::ios::binary) << std::string(900, '#') << '\n';
+        std::vector<std::string> lines;
+        {
+            auto sink = std::make_shared<rotating_file_sink>(filename, max_size, max_files, background);
+            for (int i = 0; i < 200; ++i) {
+                lines.push_back(fmt::format("第 {} 行 {}\n", i, std::string(i % 37, 'x')));
+                sink->log(lines.back());
+            }
+            sink->flush();
+            ok = ok && sink->rotations() > max_files;
+        }
+        std::string joined;
+        for (size_t i = max_files + 1; i-- > 0;) {
+            std::string content = read_file(rotating_file_sink::rotated_name(filename, i));
+            ok = ok && content.size() <= max_size && (i <= max_files || content.empty());
+            joined += content;
+        }
+        std::string expected;
+        for (const auto& line : lines) {
+            expected += line;
+        }
+        ok = ok && !joined.empty() && expected.size() >= joined.size() &&
+             expected.compare(expected.size() - joined.size(), joined.size(), joined) == 0 &&
+             joined.find(lines[lines.size() - 1]) != std::string::npos;
+        for (size_t i = 0; i <= max_files + 1; ++i) {
+            std::remove(rotating_file_sink::rotated_name(filename, i).c_str());
+        }
+    }
+    return ok;
+}
+
+// 改名链失败（log.3 被一个非空目录占住）时：记录一条不丢，pending 文件留在原地，错误由 flush 抛出；
+// 上次运行崩溃留下的 pending 文件不会被覆盖
+bool check_rotating_failure() {
+    const std::string filename = "bench_rotating_fail.log";
+    const std::string blocker = rotating_file_sink::rotated_name(filename, 3);
+    const std::string stale = filename + ".pending.0";
+    bool ok = true;
+    for (bool background : {true, false}) {
+        mkdir(blocker.c_str(), 0755);
+        std::ofstream(blocker + "/占位");
+        std::ofstream(stale) << "上次运行留下的\n";
+        size_t expected = 0;
+        bool thrown = false;
+        {
+            rotating_file_sink sink(filename, 1000, 3, background);
+            for (int i = 0; i < 200; ++i) {
+                std::string line = fmt::format("第 {} 行 {}\n", i, std::string(i % 37, 'x'));
+                expected += line.size();
+                sink.log(line);
+            }
+            try {
+                sink.flush();
+            } catch (const std::runtime_error&) {
+                thrown = true;
+            }
+        }
+        std::vector<std::string> names;
+        DIR* dir = opendir(".");
+        while (dirent* entry = readdir(dir)) {
+            std::string name = entry->d_name;
+            if (name.compare(0, filename.size(), filename) == 0 && name != blocker && name != stale) {
+                names.push_back(name);
+            }
+        }
+        closedir(dir);
+        size_t total = 0;
+        size_t pending = 0;
+        for (const auto& name : names) {
+            total += read_file(name).size();
+            pending += name.find(".pending.") != std::string::npos;
+            std::remove(name.c_str());
+        }
+        ok = ok && thrown && total == expected && pending > 0 && read_file(stale) == "上次运行留下的\n";
+        std::remove((blocker + "/占位").c_str());
+        rmdir(blocker.c_str());
+        std::remove(stale.c_str());
+    }
+    return ok;
+}
+
+void bench_rotating_sink() {
+    if (!check_rotating_sink() || !check_rotating_failure()) {
+        std::cerr << "滚动文件 sink 校验失败" << std::endl;
+        std::exit(1);
+    }
+
+    const std::string filename = "bench_rotating.log";
+    const size_t max_files = 20;
+    const int count = 300000;
+    std::string path = "/api/v1/items";
+    // 单独统计触发滚动的那些调用，不滚动的 file_sink 作为底噪
+    auto run = [&](std::shared_ptr<base_sink> sink, const rotating_file_sink* rotating, const char* name) {
+        auto logger = std::make_shared<Logger>();
+        logger->add_sink(sink);
+        std::vector<double> latencies(count);
+        std::vector<double> rotate_latencies;
+        uint64_t rotations = 0;
+        for (int i = 0; i < count; ++i) {
+            auto start = std::chrono::steady_clock::now();
+            LOG_INFO(logger, "请求 {} 完成，耗时 {} ms，路径 {}", i, i % 1000, path);
+            latencies[i] = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+            if (rotating && rotating->rotations() != rotations) {
+                rotations = rotating->rotations();
+                rotate_latencies.push_back(latencies[i]);
+            }
+        }
+        sink->flush();
+        std::sort(latencies.begin(), latencies.end());
+        std::sort(rotate_latencies.begin(), rotate_latencies.end());
+        fmt::print("[rotate] {:<14} p50 {:>5.2f} us，p99.9 {:>6.2f} us，最长 {:>7.1f} us", name, latencies[count / 2],
+                   latencies[count - count / 1000], latencies.back());
+        if (!rotate_latencies.empty()) {
+            fmt::print("；滚动 {} 次，滚动调用中位 {:.1f} us、最长 {:.1f} us", rotations,
+                       rotate_latencies[rotate_latencies.size() / 2], rotate_latencies.back());
+        }
+        fmt::print("\n");
+        for (size_t i = 0; i <= max_files; ++i) {
+            std::remove(rotating_file_sink::rotated_name(filename, i).c_str());
+        }
+    };
+    run(std::make_shared<file_sink>(filename), nullptr, "不滚动");
+    for (bool background : {true, false}) {
+        for (size_t i = 0; i <= max_files; ++i) {
+            std::ofstream(rotating_file_sink::rotated_name(filename, i)) << "旧文件\n";
+        }
+        auto sink = std::make_shared<rotating_file_sink>(filename, 1 << 20, max_files, background);
+        run(sink, sink.get(), background ? "后台改名" : "锁内同步改名");
+    }
+}
+
+// 对照：每条消息都读时钟、转换成本地日期再比较的按日切分写法
+class date_check_file_sink : public base_sink {
+public:
+    explicit date_check_file_sink(const std::string& filename) : filename_(filename) {
+        check_date();
+    }
+
+    void log(const std::string& msg) override {
+        fmt::string_view part = msg;
+        log_fragments(&part, 1);
+    }
+
+    bool fragments() const override { return true; }
+
+    void log_fragments(const fmt::string_view* parts, size_t count) override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        check_date();
+        file_helper_.write_fragments(parts, count);
+    }
+
+    void flush() override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        file_helper_.flush();
+    }
+
+    const std::string& current_file() const { return current_file_; }
+
+private:
+    void check_date() {
+        std::string name = timed_file_sink::dated_name(
+            filename_, rotation_period::daily,
+            std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch())
+                .count());
+        if (name != current_file_) {
+            file_helper_.close();
+            file_helper_.open(name, false);
+            current_file_ = name;
+        }
+    }
+
+    std::string filename_;
+    std::string current_file_;
+    file_helper file_helper_;
+    std::mutex mutex_;
+};
+
+int64_t local_time_ns(int year, int month, int day, int hour, int minute, int second) {
+    std::tm local = {};
+    local.tm_year = year - 1900;
+    local.tm_mon = month - 1;
+    local.tm_mday = day;
+    local.tm_hour = hour;
+    local.tm_min = minute;
+    local.tm_sec = second;
+    local.tm_isdst = -1;
+    return static_cast<int64_t>(std::mktime(&local)) * 1000000000;
+}
+
+bool file_exists(const std::string& filename) {
+    return std::ifstream(filename).good();
+}
+
+// 按时间切分：记录按自己的时间落到对应日期/小时的文件里，跨过零点只在切换时换文件；
+// 只保留最新的 max_files 个文件，以前留下的旧文件和空的当天文件在 flush 前删除
+bool check_timed_sink() {
+    const std::string filename = "bench_timed.log";
+    const char* stale[] = {"bench_timed_2020-01-01.log", "bench_timed_2020-01-02.log", "bench_timed_2020-01-03.log"};
+    for (const char* name : stale) {
+        std::ofstream(name) << "旧文件\n";
+    }
+    bool ok = true;
+    std::string today = timed_file_sink::dated_name(filename, rotation_period::daily,
+        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count());
+    {
+        auto sink = std::make_shared<timed_file_sink>(filename, rotation_period::daily, 3);
+        ok = ok && sink->current_file() == today;
+        int64_t before_midnight = local_time_ns(2099, 10, 16, 23, 59, 59);
+        fmt::string_view parts[2] = {"第一行", "\n"};
+        sink->log_timed(parts, 2, before_midnight);
+        parts[0] = "第二行";
+        sink->log_timed(parts, 2, before_midnight + 999999999);
+        parts[0] = "第三行";
+        sink->log_timed(parts, 2, before_midnight + 1000000000);
+        parts[0] = "第四行";
+        sink->log_timed(parts, 2, local_time_ns(2099, 10, 19, 8, 0, 0));
+        sink->flush();
+        ok = ok && sink->current_file() == "bench_timed_2099-10-19.log";
+    }
+    ok = ok && read_file("bench_timed_2099-10-16.log") == "第一行\n第二行\n" &&
+         read_file("bench_timed_2099-10-17.log") == "第三行\n" && read_file("bench_timed_2099-10-19.log") == "第四行\n" &&
+         !file_exists(today);
+    for (const char* name : stale) {
+        ok = ok && !file_exists(name);
+    }
+    ok = ok && timed_file_sink::dated_name("logs/app.log", rotation_period::hourly,
+                                           local_time_ns(2099, 1, 2, 3, 4, 5)) == "logs/app_2099-01-02_03.log" &&
+         timed_file_sink::dated_name("logs.d/app", rotation_period::daily, local_time_ns(2099, 1, 2, 3, 4, 5)) ==
+             "logs.d/app_2099-01-02";
+    for (const char* name : {"bench_timed_2099-10-16.log", "bench_timed_2099-10-17.log", "bench_timed_2099-10-19.log"}) {
+        std::remove(name);
+    }
+
+    // 经过 Logger 时使用记录的时间戳
+    {
+        auto sink = std::make_shared<timed_file_sink>(filename, rotation_period::hourly);
+        auto logger = std::make_shared<Logger>();
+        logger->add_sink(sink);
+        LOG_INFO(logger, "按小时 {}", 1);
+        sink->flush();
+        std::string content = read_file(sink->current_file());
+        ok = ok && content.find("按小时 1\n") != std::string::npos;
+        std::remove(sink->current_file().c_str());
+    }
+    return ok;
+}
+
+// 旧文件删除失败（同名的非空目录删不掉）时：切换和写入照常进行，一条不丢，错误由 flush 抛出
+bool check_timed_failure() {
+    const std::string filename = "bench_timed_fail.log";
+    const std::string blocker = "bench_timed_fail_2020-01-01.log";
+    mkdir(blocker.c_str(), 0755);
+    std::ofstream(blocker + "/占位");
+    std::vector<std::string> files;
+    std::string expected;
+    bool thrown = false;
+    bool ok = true;
+    {
+        timed_file_sink sink(filename, rotation_period::daily, 1);
+        files.push_back(sink.current_file());
+        for (int day = 16; day < 20; ++day) {
+            std::string line = fmt::format("10 月 {} 日\n", day);
+            fmt::string_view part = line;
+            try {
+                sink.log_timed(&part, 1, local_time_ns(2099, 10, day, 12, 0, 0));
+            } catch (const std::exception&) {
+                ok = false;
+            }
+            files.push_back(sink.current_file());
+            expected += line;
+        }
+        try {
+            sink.flush();
+        } catch (const std::runtime_error&) {
+            thrown = true;
+        }
+    }
+    std::string content;
+    for (const auto& name : files) {
+        if (file_exists(name)) {
+            content += read_file(name);
+            std::remove(name.c_str());
+        }
+    }
+    std::remove((blocker + "/占位").c_str());
+    rmdir(blocker.c_str());
+    return ok && thrown && content == expected;
+}
+
+void bench_timed_sink() {
+    if (!check_timed_sink() || !check_timed_failure()) {
+        std::cerr << "按时间切分的文件 sink 校验失败" << std::endl;
+        std::exit(1);
+    }
+
+    const std::string filename = "bench_timed.log";
+    const int count = 1000000;
+    std::string path = "/api/v1/items";
+    auto run = [&](std::shared_ptr<base_sink> sink, const char* name, const std::string& written) {
+        auto logger = std::make_shared<Logger>();
+        logger->add_sink(sink);
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < count; ++i) {
+            LOG_INFO(logger, "请求 {} 完成，耗时 {} ms，路径 {}", i, i % 1000, path);
+        }
+        sink->flush();
+        double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / count;
+        fmt::print("[timed] {:<18} {:>6.1f} ns/条\n", name, ns);
+        std::remove(written.c_str());
+    };
+    run(std::make_shared<file_sink>(filename), "不切分", filename);
+    auto timed = std::make_shared<timed_file_sink>(filename, rotation_period::daily);
+    run(timed, "切换时刻比较", timed->current_file());
+    timed.reset();
+    auto checked = std::make_shared<date_check_file_sink>(filename);
+    run(checked, "每条检查日期", checked->current_file());
+}
+
+// 依次解开首尾相接的 gzip 成员，返回完整成员的个数，数据损坏时返回 -1。
+// 末尾的成员不完整时（写到一半崩溃）丢弃它的内容并设置 truncated
+int gunzip_members(const std::string& data, std::string& out, bool& truncated) {
+    z_stream zs;
+    std::memset(&zs, 0, sizeof(zs));
+    if (inflateInit2(&zs, 15 + 16) != Z_OK) {
+        return -1;
+    }
+    zs.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data.data()));
+    zs.avail_in = static_cast<uInt>(data.size());
+    int members = 0;
+    truncated = false;
+    char chunk[65536];
+    while (zs.avail_in > 0) {
+        size_t member_begin = out.size();
+        int ret;
+        do {
+            zs.next_out = reinterpret_cast<Bytef*>(chunk);
+            zs.avail_out = sizeof(chunk);
+            ret = inflate(&zs, Z_NO_FLUSH);
+            out.append(chunk, sizeof(chunk) - zs.avail_out);
+        } while (ret == Z_OK);
+        if (ret != Z_STREAM_END) {
+            inflateEnd(&zs);
+            out.resize(member_begin);
+            truncated = ret == Z_BUF_ERROR && zs.avail_in == 0;
+            return truncated ? members : -1;
+        }
+        ++members;
+        inflateReset(&zs);
+    }
+    inflateEnd(&zs);
+    return members;
+}
+
+// 压缩：每批压成一个独立的 gzip 成员，flush 把不满一帧的批次也写出；
+// 解开后与写入的文本一致，截掉最后一帧时前面的帧仍能解开
+bool check_compressed_sink() {
+    const std::string filename = "bench_compressed.log.gz";
+    std::remove(filename.c_str());
+    const size_t frame_size = 64 * 1024;
+    std::string expected;
+    auto write_lines = [&](compressed_file_sink& sink, int begin, int end) {
+        for (int i = begin; i < end; ++i) {
+            std::string line = fmt::format("[Sat Oct 17 10:00:00 2026] [INFO] 请求 {} 完成，耗时 {} ms\n", i, i % 97);
+            expected += line;
+            sink.log(line);
+        }
+    };
+    bool ok = true;
+    {
+        compressed_file_sink sink(filename, compression_codec::deflate, 1, frame_size);
+        write_lines(sink, 0, 3000);
+        sink.flush();
+        auto stats = sink.stats();
+        ok = ok && stats.input_bytes == expected.size() && stats.frames == (expected.size() + frame_size - 1) / frame_size;
+        ok = ok && stats.output_bytes == read_file(filename).size();
+        write_lines(sink, 3000, 3100);
+    }
+    std::string data = read_file(filename);
+    std::string text;
+    bool truncated;
+    int members = gunzip_members(data, text, truncated);
+    ok = ok && members >= 3 && !truncated && text == expected;
+
+    // 模拟写最后一帧时崩溃：截掉文件末尾，之前的帧仍完整可读
+    std::string survived;
+    ok = ok && gunzip_members(data.substr(0, data.size() - 10), survived, truncated) == members - 1 && truncated &&
+         !survived.empty() && survived.size() < expected.size() && expected.compare(0, survived.size(), survived) == 0;
+    std::remove(filename.c_str());
+
+    // 写入失败（/dev/full 返回 ENOSPC）不从 log 抛出，由 flush 抛出一次
+    {
+        compressed_file_sink sink("/dev/full", compression_codec::deflate, 1, 4096);
+        bool thrown = false;
+        try {
+            for (int i = 0; i < 1000; ++i) {
+                sink.log(fmt::format("第 {} 行\n", i));
+            }
+        } catch (const std::exception&) {
+            ok = false;
+        }
+        try {
+            sink.flush();
+        } catch (const std::runtime_error&) {
+            thrown = true;
+        }
+        ok = ok && thrown;
+        try {
+            sink.flush();
+        } catch (const std::exception&) {
+            ok = false;
+        }
+    }
+
+#ifndef LOGGER_HAS_ZSTD
+    try {
+        compressed_file_sink sink(filename, compression_codec::zstd);
+        ok = false;
+    } catch (const std::runtime_error&) {
+    }
+    std::remove(filename.c_str());
+#endif
+    return ok;
+}
+
+void bench_compressed_sink() {
+    if (!check_compressed_sink()) {
+        std::cerr << "压缩文件 sink 校验失败" << std::endl;
+        std::exit(1);
+    }
+
+    const int count = 1000000;
+    std::string path = "/api/v1/items";
+    std::mt19937 rng(7);
+    auto run = [&](std::shared_ptr<base_sink> sink, const compressed_file_sink* compressed, const char* name,
+                   const std::string& filename) {
+        auto logger = std::make_shared<Logger>();
+        logger->add_sink(sink);
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < count; ++i) {
+            LOG_INFO(logger, "请求 {} 完成，耗时 {} ms，路径 {}，用户 {}", i, rng() % 1000, path, rng() % 50000);
+        }
+        sink->flush();
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        uint64_t on_disk = read_file(filename).size();
+        if (compressed) {
+            auto stats = compressed->stats();
+            fmt::print("[compress] {:<12} {:>6.1f} ns/条，输入 {:>6.1f} MB/s，压缩线程 {:>6.1f} MB/s，压缩比 {:>5.2f}，{} 帧\n",
+                       name, seconds * 1e9 / count, stats.input_bytes / seconds / 1e6,
+                       stats.input_bytes / (stats.compress_ns / 1e9) / 1e6,
+                       static_cast<double>(stats.input_bytes) / on_disk, stats.frames);
+        } else {
+            fmt::print("[compress] {:<12} {:>6.1f} ns/条，输入 {:>6.1f} MB/s\n", name, seconds * 1e9 / count,
+                       on_disk / seconds / 1e6);
+        }
+        std::remove(filename.c_str());
+    };
+    run(std::make_shared<file_sink>("bench_compressed.log"), nullptr, "不压缩", "bench_compressed.log");
+    for (int level : {1, 6}) {
+        std::string filename = "bench_compressed.log.gz";
+        auto sink = std::make_shared<compressed_file_sink>(filename, compression_codec::deflate, level);
+        run(sink, sink.get(), level == 1 ? "deflate -1" : "deflate -6", filename);
+    }
+#ifdef LOGGER_HAS_ZSTD
+    for (int level : {1, 3}) {
+        std::string filename = "bench_compressed.log.zst";
+        auto sink = std::make_shared<compressed_file_sink>(filename, compression_codec::zstd, level);
+        run(sink, sink.get(), level == 1 ? "zstd -1" : "zstd -3", filename);
+    }
+#endif
+}
+
+// 本进程至今发出的 write 类系统调用次数，/proc 不可用时返回 0
+uint64_t write_syscalls() {
+    std::ifstream io("/proc/self/io");
+    std::string key;
+    uint64_t value;
+    while (io >> key >> value) {
+        if (key == "syscw:") {
+            return value;
+        }
+    }
+    return 0;
+}
+
+// flush 时尝试修改定时 flush 的 sink，用来确认定时线程内的调用被拒绝而不是 join 自己
+class reconfigure_on_flush_sink : public base_sink {
+public:
+    reconfigure_on_flush_sink() : rejected(false), flushed(false) {}
+
+    void log(const std::string&) override {}
+
+    // 只在第一次 flush 时尝试，之后在别的线程上 flush_all 也不会改动定时线程
+    void flush() override {
+        if (flushed) {
+            return;
+        }
+        try {
+            Registry::getInstance().flush_every(std::chrono::milliseconds(1));
+        } catch (const std::runtime_error&) {
+            rejected = true;
+        }
+        flushed = true;
+    }
+
+    std::atomic<bool> rejected;
+    std::atomic<bool> flushed;
+};
+
+// 多个线程同时修改间隔不会 std::terminate；定时线程内调用 flush_every 抛出异常
+bool check_flush_every_races() {
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([t] {
+            for (int i = 0; i < 50; ++i) {
+                Registry::getInstance().flush_every(std::chrono::milliseconds((t + i) % 3));
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    auto sink = std::make_shared<reconfigure_on_flush_sink>();
+    auto logger = std::make_shared<Logger>();
+    logger->add_sink(sink);
+    Registry::getInstance().registerLogger("bench_flush_self", logger);
+    Registry::getInstance().flush_every(std::chrono::milliseconds(1));
+    for (int i = 0; i < 200 && !sink->flushed; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    Registry::getInstance().flush_every(std::chrono::milliseconds(0));
+    return sink->flushed && sink->rejected;
+}
+
+// flush 策略：缓冲里的行只在达到级别、写入量阈值或定时 flush 时才出现在文件里
+bool check_flush_policies() {
+    const std::string filename = "bench_flush.log";
+    std::remove(filename.c_str());
+    bool ok = true;
+    auto count_lines = [&] {
+        std::string content = read_file(filename);
+        return std::count(content.begin(), content.end(), '\n');
+    };
+    {
+        auto sink = std::make_shared<file_sink>(filename);
+        auto logger = std::make_shared<Logger>();
+        logger->add_sink(sink);
+        logger->flush_on(Logger::WARNING);
+        LOG_INFO(logger, "缓冲中 {}", 1);
+        ok = ok && count_lines() == 0;
+        LOG_WARNING(logger, "按级别 flush {}", 2);
+        ok = ok && count_lines() == 2;
+
+        logger->flush_on(Logger::ERROR);
+        sink->set_flush_threshold(0, 3);
+        LOG_INFO(logger, "第 {} 条", 1);
+        LOG_INFO(logger, "第 {} 条", 2);
+        ok = ok && count_lines() == 2;
+        LOG_INFO(logger, "第 {} 条", 3);
+        ok = ok && count_lines() == 5;
+
+        sink->set_flush_threshold(1, 0);
+        LOG_INFO(logger, "每条都 flush {}", 4);
+        ok = ok && count_lines() == 6;
+
+        sink->set_flush_threshold(0, 0);
+        LOG_INFO(logger, "定时 flush {}", 5);
+        ok = ok && count_lines() == 6;
+        Registry::getInstance().registerLogger("bench_flush", logger);
+        Registry::getInstance().flush_every(std::chrono::milliseconds(10));
+        for (int i = 0; i < 200 && count_lines() != 7; ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+        ok = ok && count_lines() == 7;
+        Registry::getInstance().flush_every(std::chrono::milliseconds(0));
+        LOG_INFO(logger, "停止后不再 flush {}", 6);
+        std::this_thread::sleep_for(std::chrono::milliseconds(30));
+        ok = ok && count_lines() == 7;
+        Registry::getInstance().flush_all();
+        ok = ok && count_lines() == 8;
+    }
+    std::remove(filename.c_str());
+    return ok && check_flush_every_races();
+}
+
+void bench_flush_policies() {
+    if (!check_flush_policies()) {
+        std::cerr << "flush 策略校验失败" << std::endl;
+        std::exit(1);
+    }
+
+    const std::string filename = "bench_flush.log";
+    const int count = 1000000;
+    std::string path = "/api/v1/items";
+    // name 为空时不注册；注册的 logger 由定时线程 flush
+    auto run = [&](const char* label, std::function<void(Logger&, file_sink&)> setup, const std::string& name) {
+        auto sink = std::make_shared<file_sink>(filename);
+        auto logger = std::make_shared<Logger>();
+        logger->add_sink(sink);
+        setup(*logger, *sink);
+        if (!name.empty()) {
+            Registry::getInstance().registerLogger(name, logger);
+        }
+        uint64_t before = write_syscalls();
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < count; ++i) {
+            LOG_INFO(logger, "请求 {} 完成，耗时 {} ms，路径 {}", i, i % 1000, path);
+        }
+        double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / count;
+        uint64_t syscalls = write_syscalls() - before;
+        Registry::getInstance().flush_every(std::chrono::milliseconds(0));
+        fmt::print("[flush] {:<22} {:>6.1f} ns/条，每 100 万条 {:>8} 次 write\n", label, ns, syscalls);
+        std::remove(filename.c_str());
+    };
+    run("只靠 64KB 缓冲", [](Logger&, file_sink&) {}, "");
+    run("定时 flush_every(10ms)", [](Logger&, file_sink&) {
+        Registry::getInstance().flush_every(std::chrono::milliseconds(10));
+    }, "bench_flush_every");
+    run("阈值 16KB", [](Logger&, file_sink& sink) { sink.set_flush_threshold(16 * 1024, 0); }, "");
+    run("阈值 100 条", [](Logger&, file_sink& sink) { sink.set_flush_threshold(0, 100); }, "");
+    run("flush_on(INFO)", [](Logger& logger, file_sink&) { logger.flush_on(Logger::INFO); }, "");
+}
+
+// 落盘确认：wait 返回时票据之前的记录都已写进文件；并发等待者共用 fdatasync，次数不超过提交数
+bool check_durable_sink() {
+    const std::string filename = "bench_durable.log";
+    std::remove(filename.c_str());
+    bool ok = true;
+    {
+        auto sink = std::make_shared<durable_file_sink>(filename);
+        auto logger = std::make_shared<Logger>();
+        logger->add_sink(sink);
+        sink->wait(0);
+        ok = ok && sink->syncs() == 0;
+        LOG_ERROR(logger, "审计 {}", 1);
+        LOG_ERROR(logger, "审计 {}", 2);
+        uint64_t ticket = sink->ticket();
+        ok = ok && ticket == 2;
+        sink->wait(ticket);
+        ok = ok && sink->syncs() == 1 && read_file(filename).find("审计 2\n") != std::string::npos;
+        sink->wait(ticket);
+        ok = ok && sink->syncs() == 1;
+
+        const int threads = 8;
+        const int commits = 50;
+        std::vector<std::thread> workers;
+        for (int t = 0; t < threads; ++t) {
+            workers.emplace_back([&, t] {
+                for (int i = 0; i < commits; ++i) {
+                    LOG_ERROR(logger, "线程 {} 提交 {}", t, i);
+                    sink->sync();
+                }
+            });
+        }
+        for (auto& worker : workers) {
+            worker.join();
+        }
+        std::string content = read_file(filename);
+        ok = ok && std::count(content.begin(), content.end(), '\n') == 2 + threads * commits &&
+             sink->syncs() <= 1 + threads * commits;
+
+        // 票据只统计已交到 sink 的记录，不能挂到异步 logger 上
+        AsyncLogger async_logger;
+        try {
+            async_logger.add_sink(sink);
+            ok = false;
+        } catch (const std::runtime_error&) {
+        }
+    }
+    std::remove(filename.c_str());
+    return ok;
+}
+
+void bench_durable_sink() {
+    if (!check_durable_sink()) {
+        std::cerr << "落盘确认 sink 校验失败" << std::endl;
+        std::exit(1);
+    }
+
+    const std::string filename = "bench_durable.log";
+    const auto duration = std::chrono::milliseconds(400);
+    // serial 为 true 时每次提交独占 fdatasync，作为不合批的对照
+    auto run = [&](int threads, bool serial) {
+        auto sink = std::make_shared<durable_file_sink>(filename);
+        auto logger = std::make_shared<Logger>();
+        logger->add_sink(sink);
+        std::mutex serial_mutex;
+        std::vector<std::vector<double>> latencies(threads);
+        std::atomic<bool> stop(false);
+        std::vector<std::thread> workers;
+        for (int t = 0; t < threads; ++t) {
+            workers.emplace_back([&, t] {
+                int i = 0;
+                while (!stop.load(std::memory_order_relaxed)) {
+                    auto start = std::chrono::steady_clock::now();
+                    if (serial) {
+                        std::lock_guard<std::mutex> lock(serial_mutex);
+                        LOG_ERROR(logger, "线程 {} 提交 {}", t, i);
+                        sink->sync();
+                    } else {
+                        LOG_ERROR(logger, "线程 {} 提交 {}", t, i);
+                        sink->sync();
+                    }
+                    latencies[t].push_back(
+                        std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+                    ++i;
+                }
+            });
+        }
+        std::this_thread::sleep_for(duration);
+        stop = true;
+        for (auto& worker : workers) {
+            worker.join();
+        }
+        std::vector<double> all;
+        for (auto& per_thread : latencies) {
+            all.insert(all.end(), per_thread.begin(), per_thread.end());
+        }
+        std::sort(all.begin(), all.end());
+        double seconds = std::chrono::duration<double>(duration).count();
+        fmt::print("[durable] {:>2} 个等待者{:<6} {:>7.0f} 次提交/s，p50 {:>7.1f} us，p99 {:>8.1f} us，每次 fdatasync {:>5.1f} 条\n",
+                   threads, serial ? "，逐条" : "", all.size() / seconds, all[all.size() / 2],
+                   all[all.size() * 99 / 100], static_cast<double>(all.size()) / sink->syncs());
+        std::remove(filename.c_str());
+    };
+    run(1, false);
+    for (int threads : {2, 4, 8, 16, 32}) {
+        run(threads, true);
+        run(threads, false);
+    }
+}
+
+// 文件当前留在页缓存里的字节数（mincore 统计驻留页）
+uint64_t resident_bytes(const std::string& filename) {
+    int fd = ::open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return 0;
+    }
+    struct stat st;
+    uint64_t resident = 0;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        size_t size = static_cast<size_t>(st.st_size);
+        void* map = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+        if (map != MAP_FAILED) {
+            size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+            std::vector<unsigned char> pages((size + page - 1) / page);
+            if (mincore(map, size, pages.data()) == 0) {
+                for (unsigned char p : pages) {
+                    resident += (p & 1) ? page : 0;
+                }
+            }
+            munmap(map, size);
+        }
+    }
+    ::close(fd);
+    return resident;
+}
+
+// /proc/meminfo 中整个系统的脏页字节数
+uint64_t dirty_bytes() {
+    std::ifstream meminfo("/proc/meminfo");
+    std::string key;
+    uint64_t value;
+    std::string unit;
+    while (meminfo >> key >> value >> unit) {
+        if (key == "Dirty:") {
+            return value * 1024;
+        }
+    }
+    return 0;
+}
+
+// 增量回写：文件内容完整，已写过的部分不再留在页缓存；已有内容不受影响；
+// 不支持 sync_file_range 的文件（字符设备）自动关闭回写
+bool check_writeback() {
+    const std::string filename = "bench_writeback.log";
+    const size_t chunk = 1024 * 1024;
+    std::remove(filename.c_str());
+    std::ofstream(filename) << "已有内容\n";
+    std::string line(99, 'x');
+    line += '\n';
+    const size_t lines = 24 * chunk / line.size();
+    bool ok = true;
+    {
+        file_sink sink(filename);
+        sink.set_writeback(chunk);
+        for (size_t i = 0; i < lines; ++i) {
+            sink.log(line);
+        }
+        sink.flush();
+        uint64_t resident = resident_bytes(filename);
+        ok = ok && resident <= 3 * chunk;
+    }
+    std::string content = read_file(filename);
+    ok = ok && content.size() == std::strlen("已有内容\n") + lines * line.size() &&
+         content.compare(0, std::strlen("已有内容\n"), "已有内容\n") == 0;
+    std::remove(filename.c_str());
+
+    file_helper null_file;
+    null_file.open("/dev/null");
+    null_file.set_writeback(4096);
+    for (int i = 0; i < 1000; ++i) {
+        null_file.write(line);
+    }
+    null_file.flush();
+    ok = ok && null_file.writeback() == 0;
+    return ok;
+}
+
+void bench_writeback() {
+    if (!check_writeback()) {
+        std::cerr << "增量回写校验失败" << std::endl;
+        std::exit(1);
+    }
+
+    const std::string filename = "bench_writeback.log";
+    const uint64_t total = 256ull * 1024 * 1024;
+    std::string path = "/api/v1/items";
+    auto run = [&](size_t chunk, const char* name) {
+        ::sync();
+        auto sink = std::make_shared<file_sink>(filename);
+        sink->set_writeback(chunk);
+        auto logger = std::make_shared<Logger>();
+        logger->add_sink(sink);
+        std::vector<double> latencies;
+        uint64_t max_dirty = 0;
+        auto begin = std::chrono::steady_clock::now();
+        for (uint64_t i = 0;; ++i) {
+            auto start = std::chrono::steady_clock::now();
+            LOG_INFO(logger, "请求 {} 完成，耗时 {} ms，路径 {}", i, i % 1000, path);
+            latencies.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+            if (i % 100000 == 0) {
+                max_dirty = std::max(max_dirty, dirty_bytes());
+                struct stat st;
+                if (stat(filename.c_str(), &st) == 0 && static_cast<uint64_t>(st.st_size) >= total) {
+                    break;
+                }
+            }
+        }
+        sink->flush();
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+        std::sort(latencies.begin(), latencies.end());
+        size_t n = latencies.size();
+        fmt::print("[writeback] {:<14} {:>6.0f} MB/s，p50 {:>4.2f} us，p99.9 {:>6.1f} us，最长 {:>8.1f} us，"
+                   "页缓存 {:>5.1f} MB，系统脏页峰值 {:>5.1f} MB\n",
+                   name, total / seconds / 1e6, latencies[n / 2], latencies[n - n / 1000], latencies.back(),
+                   resident_bytes(filename) / 1e6, max_dirty / 1e6);
+        std::remove(filename.c_str());
+    };
+    run(0, "不回写");
+    run(8 * 1024 * 1024, "每 8MB 回写");
+}
+
+// 异步记录的内联缓冲：打包典型消息不分配，超长记录溢出到堆并计入直方图
+bool check_record_buffer() {
+    const std::string text_file = "bench_record.log";
+    std::remove(text_file.c_str());
+    std::string long_text(1000, 'x');
+    AsyncLogger::record_stats stats;
+    uint64_t allocations;
+    {
+        auto logger = std::make_shared<AsyncLogger>();
+        logger->add_sink(std::make_shared<file_sink>(text_file));
+        // 第一条记录会登记调用点、初始化线程信息，从第二条开始计
+        uint64_t before = 0;
+        for (int i = 0; i < 100; ++i) {
+            before = i == 1 ? thread_allocations : before;
+            LOG_ERROR(logger, "错误代码：{}。错误信息：{}", 404, "未找到");
+        }
+        allocations = thread_allocations - before;
+        logger->log(Logger::ERROR, "超长 {}", long_text);
+        stats = logger->stats();
+    }
+    std::string text = read_file(text_file);
+    std::remove(text_file.c_str());
+    size_t lines = std::count(text.begin(), text.end(), '\n');
+    // 放得进内联缓冲的记录，生产者打包和入队都不分配
+    return stats.total == 101 && stats.spilled == 1 && lines == 101 && allocations == 0 &&
+           text.find("超长 " + long_text + "\n") != std::string::npos;
+}
+
+template <typename Buffer>
+double bench_pack(int count, uint64_t& allocations) {
+    int code = 503;
+    std::string reason = "服务不可用";
+    auto store = fmt::make_format_args(code, reason);
+    fmt::format_args args = store;
+    uint64_t before = thread_allocations;
+    size_t total = 0;
+    double seconds = measure_seconds([&] {
+        for (int i = 0; i < count; ++i) {
+            Buffer payload;
+            pack_args(payload, "{} {}", args);
+            total += payload.size();
+        }
+    });
+    allocations = thread_allocations - before;
+    if (total == 0) {
+        std::cerr << std::endl;
+    }
+    return seconds * 1e9 / count;
+}
+
+// block 策略：队列满时生产者等工作线程取走任务，而不是永远阻塞；每个任务都执行且按顺序
+bool check_thread_pool_block() {
+    std::vector<int> done;
+    {
+        ThreadPool pool(1, 2, async_overflow_policy::block);
+        for (int i = 0; i < 1000; ++i) {
+            pool.enqueue([&done, i] {
+                if (i % 100 == 0) {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                }
+                done.push_back(i);
+            });
+        }
+    }
+    for (int i = 0; i < static_cast<int>(done.size()); ++i) {
+        if (done[i] != i) {
+            return false;
+        }
+    }
+    return done.size() == 1000;
+}
+
+void bench_record() {
+    if (!check_record_buffer() || !check_thread_pool_block()) {
+        std::cerr << "异步记录缓冲校验失败" << std::endl;
+        std::exit(1);
+    }
+
+    const int count = 5000000;
+    uint64_t string_allocations, inline_allocations;
+    double string_ns = bench_pack<std::string>(count, string_allocations);
+    double inline_ns = bench_pack<fmt::basic_memory_buffer<char, LOGGER_RECORD_INLINE_SIZE>>(count, inline_allocations);
+    fmt::print("[record] 打包典型参数：std::string {:.1f} ns/条 {:.2f} 次分配/条，内联缓冲 {:.1f} ns/条 {:.2f} 次分配/条\n",
+               string_ns, double(string_allocations) / count, inline_ns, double(inline_allocations) / count);
+
+    // 混合长度的消息走一遍异步路径，打印大小分布
+    auto logger = std::make_shared<AsyncLogger>();
+    logger->add_sink(std::make_shared<file_sink>("/dev/null"));
+    std::string path(300, 'p');
+    const int records = 200000;
+    uint64_t before = thread_allocations;
+    for (int i = 0; i < records; ++i) {
+        if (i % 10 == 0) {
+            LOG_WARNING(logger, "长路径 {} 第 {} 次", path, i);
+        } else {
+            LOG_ERROR(logger, "错误代码：{}。错误信息：{}", 503, "服务不可用");
+        }
+    }
+    uint64_t producer_allocations = thread_allocations - before;
+    AsyncLogger::record_stats stats = logger->stats();
+    fmt::memory_buffer histogram;
+    for (size_t i = 0; i < AsyncLogger::record_stats::bucket_count; ++i) {
+        if (i + 1 < AsyncLogger::record_stats::bucket_count) {
+            fmt::format_to(std::back_inserter(histogram), " <={}:{}", AsyncLogger::record_stats::bucket_limit(i), stats.buckets[i]);
+        } else {
+            fmt::format_to(std::back_inserter(histogram), " >4096:{}", stats.buckets[i]);
+        }
+    }
+    fmt::print("[record] 溢出 {}/{} ({:.1f}%)，大小分布{}，生产者 {:.2f} 次分配/条（含入队）\n", stats.spilled,
+               stats.total, 100.0 * stats.spilled / stats.total, fmt::to_string(histogram),
+               double(producer_allocations) / records);
+}
+
+// 静态字符串参数：异步路径只入队指针，文本与二进制输出内容不变
+bool check_static_args() {
+    const std::string text_file = "bench_static.log";
+    const std::string binary_file = "bench_static.blog";
+    std::remove(text_file.c_str());
+    std::remove(binary_file.c_str());
+    static const char* const reasons[] = {"未找到", "内部服务器错误", "服务不可用"};
+    {
+        auto logger = std::make_shared<AsyncLogger>();
+        logger->add_sink(std::make_shared<file_sink>(text_file));
+        logger->add_sink(std::make_shared<binary_file_sink>(binary_file));
+        for (int i = 0; i < 300; ++i) {
+            LOG_ERROR(logger, "错误代码：{}。错误信息：{} {:>8}", 500 + i % 3, static_str(reasons[i % 3]), "末尾"_static);
+            logger->log(Logger::WARNING, "动态 {} 静态 {}", std::to_string(i), "字面量"_static);
+        }
+    }
+    std::string decoded;
+    binary_log_reader reader(read_file(binary_file));
+    std::string line;
+    while (reader.next(line)) {
+        decoded += line;
+    }
+    std::string text = read_file(text_file);
+    std::remove(text_file.c_str());
+    std::remove(binary_file.c_str());
+    return decoded == text && std::count(text.begin(), text.end(), '\n') == 600 &&
+           text.find("错误信息：内部服务器错误     末尾\n") != std::string::npos &&
+           text.find("动态 299 静态 字面量\n") != std::string::npos;
+}
+
+// 4.cpp 中的典型调用：字符串字面量参数是否按静态字符串入队，对比平均入队字节数
+void bench_static_args() {
+    if (!check_static_args()) {
+        std::cerr << "静态字符串参数校验失败" << std::endl;
+        std::exit(1);
+    }
+
+    const int count = 20000;
+    auto run = [count](bool mark_static) {
+        auto logger = std::make_shared<AsyncLogger>();
+        logger->add_sink(std::make_shared<file_sink>("/dev/null"));
+        for (int i = 0; i < count; ++i) {
+            if (mark_static) {
+                LOG_ERROR(logger, "错误代码：{}。错误信息：{}", 404, "未找到"_static);
+                LOG_ERROR(logger, "错误代码：{}。错误信息：{}", 500, "内部服务器错误"_static);
+                LOG_ERROR(logger, "请求 {} 失败：{}，{}", i, "服务不可用，请稍后重试"_static, "上游超时"_static);
+            } else {
+                LOG_ERROR(logger, "错误代码：{}。错误信息：{}", 404, "未找到");
+                LOG_ERROR(logger, "错误代码：{}。错误信息：{}", 500, "内部服务器错误");
+                LOG_ERROR(logger, "请求 {} 失败：{}，{}", i, "服务不可用，请稍后重试", "上游超时");
+            }
+        }
+        AsyncLogger::record_stats stats = logger->stats();
+        return double(stats.bytes) / stats.total;
+    };
+    double copied = run(false);
+    double pointers = run(true);
+    fmt::print("[static] 入队字节：拷贝 {:.1f} 字节/条，静态指针 {:.1f} 字节/条 ({:+.0f}%)\n",
+               copied, pointers, (pointers / copied - 1) * 100);
+}
+
+int main() {
+    try {
+        bench_file_helper();
+        bench_fragments();
+        bench_uring_sink();
+        bench_mmap_sink();
+        bench_rotating_sink();
+        bench_timed_sink();
+        bench_compressed_sink();
+        bench_flush_policies();
+        bench_durable_sink();
+        bench_writeback();
+        bench_binary_format();
+        bench_clock_sources();
+        bench_thread_field();
+        bench_header();
+        bench_json();
+        bench_escape();
+        bench_utf8();
+        bench_lazy();
+        bench_bounded_range();
+        bench_hex_dump();
+        bench_sync_threads();
+        bench_record();
+        bench_static_args();
+    } catch (const std::exception& e) {
+        std::cerr << "基准测试失败: " << e.what() << std::endl;
+        return -1;
+    }
+    return 0;
+}
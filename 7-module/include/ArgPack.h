@@ -0,0 +1,463 @@
+#ifndef ARG_PACK_H
+#define ARG_PACK_H
+
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <fmt/format.h>
+#include <fmt/args.h>
+
+// 参数的二进制打包格式：每个参数 = 1 字节类型标签 + 数据。
+// 平凡类型按原始字节内联存放，字符串为 uint32 长度前缀 + 字节。
+// 生产者只做 memcpy，格式化推迟到消费者线程解包后再进行。
+enum class packed_type : uint8_t {
+    int32,
+    uint32,
+    int64,
+    uint64,
+    boolean,
+    character,
+    float32,
+    float64,
+    long_double,
+    string,
+    pointer,
+    static_string, // 静态存储期的字符串：只保存指针和长度，仅在进程内的异步队列中使用
+    formatted      // 自定义类型在生产者端按各个替换域格式化好的文本，解包后原样输出
+};
+
+// 静态存储期的字符串参数，异步路径只记录指针，不拷贝内容：
+//   LOG_ERROR(logger, "错误信息：{}", "未找到"_static);
+//   LOG_ERROR(logger, "错误信息：{}", static_str(reason_table[code]));
+// 字面量后缀只能用于字符串字面量，编译期保证安全；构造函数由调用方保证字符串在进程内一直有效。
+// 对 fmt 来说它就是普通字符串：fmt 9 通过隐式转换为 string_view 识别，
+// 更新的版本按 std::string 的接口（value_type、find_first_of）识别
+class static_str {
+public:
+    typedef char value_type;
+
+    constexpr static_str(const char* data, size_t size) : data_(data), size_(size) {}
+    explicit static_str(const char* str) : data_(str), size_(std::strlen(str)) {}
+
+    const char* data() const { return data_; }
+    size_t size() const { return size_; }
+
+    size_t find_first_of(char c, size_t pos = 0) const {
+        const void* p = pos < size_ ? std::memchr(data_ + pos, c, size_ - pos) : nullptr;
+        return p ? static_cast<const char*>(p) - data_ : std::string::npos;
+    }
+
+    operator fmt::string_view() const { return fmt::string_view(data_, size_); }
+
+private:
+    const char* data_;
+    size_t size_;
+};
+
+inline static_str operator"" _static(const char* str, size_t size) {
+    return static_str(str, size);
+}
+
+// 参数类型签名：每个参数一个字符，编译期生成，供调用点元数据和解码工具使用
+//   i/I 有符号 32/64 位整数，u/U 无符号 32/64 位整数，b bool，c char，
+//   f float，d double，D long double，s 字符串，p 指针，? 其他（生产者端格式化）
+template <typename T, typename Enable = void>
+struct arg_code {
+    static constexpr char value = '?';
+};
+
+template <typename T>
+struct arg_code<T, typename std::enable_if<std::is_integral<T>::value &&
+                                           !std::is_same<T, bool>::value &&
+                                           !std::is_same<T, char>::value>::type> {
+    static constexpr char value = std::is_signed<T>::value ? (sizeof(T) <= 4 ? 'i' : 'I')
+                                                           : (sizeof(T) <= 4 ? 'u' : 'U');
+};
+
+template <typename T>
+struct arg_code<T*> {
+    static constexpr char value = 'p';
+};
+
+template <> struct arg_code<bool> { static constexpr char value = 'b'; };
+template <> struct arg_code<char> { static constexpr char value = 'c'; };
+template <> struct arg_code<float> { static constexpr char value = 'f'; };
+template <> struct arg_code<double> { static constexpr char value = 'd'; };
+template <> struct arg_code<long double> { static constexpr char value = 'D'; };
+template <> struct arg_code<char*> { static constexpr char value = 's'; };
+template <> struct arg_code<const char*> { static constexpr char value = 's'; };
+template <> struct arg_code<std::string> { static constexpr char value = 's'; };
+template <> struct arg_code<fmt::string_view> { static constexpr char value = 's'; };
+template <> struct arg_code<static_str> { static constexpr char value = 's'; };
+
+// 编译期求出哪些参数是 static_str：第 i 位对应第 i 个参数，超过 64 个参数的部分按普通字符串处理
+template <typename... Args>
+struct static_arg_mask;
+
+template <>
+struct static_arg_mask<> {
+    static constexpr uint64_t value = 0;
+};
+
+template <typename T, typename... Rest>
+struct static_arg_mask<T, Rest...> {
+    static constexpr uint64_t value = (std::is_same<typename std::decay<T>::type, static_str>::value ? 1 : 0) |
+                                      (sizeof...(Rest) < 64 ? static_arg_mask<Rest...>::value << 1 : 0);
+};
+
+template <typename... Args>
+struct arg_signature {
+    static constexpr char value[sizeof...(Args) + 1] = {
+        arg_code<typename std::decay<Args>::type>::value..., '\0'};
+};
+
+template <typename... Args>
+constexpr char arg_signature<Args...>::value[sizeof...(Args) + 1];
+
+// 仅用于 decltype，从宏参数推导签名而不求值
+template <typename... Args>
+arg_signature<Args...> make_arg_signature(const Args&...);
+
+template <typename Buffer>
+inline void pack_raw(Buffer& buf, const void* data, size_t size) {
+    const char* p = static_cast<const char*>(data);
+    buf.append(p, p + size);
+}
+
+// std::string 的迭代器区间 append 会先构造临时字符串再 replace，按指针和长度追加
+inline void pack_raw(std::string& buf, const void* data, size_t size) {
+    buf.append(static_cast<const char*>(data), size);
+}
+
+template <typename Buffer>
+inline void pack_string(Buffer& buf, fmt::string_view str) {
+    uint32_t size = static_cast<uint32_t>(str.size());
+    pack_raw(buf, &size, sizeof(size));
+    pack_raw(buf, str.data(), str.size());
+}
+
+// 读取替换域中的参数编号：数字为显式编号，空为自动编号（取 next_id 并递增），名字返回 -1
+inline int parse_arg_id(const char*& p, const char* end, int& next_id) {
+    if (p == end || *p == '}' || *p == ':') {
+        return next_id++;
+    }
+    if (*p >= '0' && *p <= '9') {
+        int id = 0;
+        while (p != end && *p >= '0' && *p <= '9') {
+            id = id * 10 + (*p++ - '0');
+        }
+        return id;
+    }
+    while (p != end && *p != '}' && *p != ':') {
+        ++p;
+    }
+    return -1;
+}
+
+// 依次找出格式串中引用第 index 个参数的每个替换域，改写成全部显式编号的形式交给 f，
+// 嵌套的动态宽度、精度一并改写，例如 "{} {:>{}.3f}" 中第 1 个参数得到 "{1:>{2}.3f}"。
+// 一个也没有（或用到了命名参数）时交给 f 的是 "{index}"，即不带说明符。返回调用 f 的次数
+template <typename F>
+inline uint32_t for_each_replacement_field(fmt::string_view format, int index, F f) {
+    fmt::basic_memory_buffer<char, 64> field;
+    uint32_t count = 0;
+    const char* p = format.data();
+    const char* end = p + format.size();
+    int next_id = 0;
+    while (p != end) {
+        if (*p++ != '{') {
+            continue;
+        }
+        if (p != end && *p == '{') {
+            ++p;
+            continue;
+        }
+        int id = parse_arg_id(p, end, next_id);
+        bool match = id == index;
+        bool named = false;
+        field.clear();
+        fmt::format_to(std::back_inserter(field), "{{{}", id);
+        if (p != end && *p == ':') {
+            field.push_back(':');
+            ++p;
+            while (p != end && *p != '}') {
+                if (*p != '{') {
+                    field.push_back(*p++);
+                    continue;
+                }
+                ++p;
+                int nested = parse_arg_id(p, end, next_id);
+                named = named || nested < 0;
+                if (p != end && *p == '}') {
+                    ++p;
+                }
+                fmt::format_to(std::back_inserter(field), "{{{}}}", nested);
+            }
+        }
+        if (p != end) {
+            ++p;
+        }
+        if (match && named) {
+            count = 0;
+            break;
+        }
+        if (match) {
+            field.push_back('}');
+            f(fmt::string_view(field.data(), field.size()));
+            ++count;
+        }
+    }
+    if (count == 0) {
+        field.clear();
+        fmt::format_to(std::back_inserter(field), "{{{}}}", index);
+        f(fmt::string_view(field.data(), field.size()));
+        count = 1;
+    }
+    return count;
+}
+
+// 生产者端已经格式化好的自定义类型参数：count 段 ArgPack 字符串，格式串中每个引用它的替换域各一段。
+// 格式说明符（含嵌套的动态宽度、精度）在生产者端已经生效，这里只消耗它并保持自动编号同步，
+// 按替换域出现的顺序轮流输出各段文本
+struct preformatted_arg {
+    const char* data;
+    uint32_t count;
+    mutable uint32_t next;
+
+    fmt::string_view get() const {
+        const char* p = data;
+        for (uint32_t i = next++ % count; i > 0; --i) {
+            p += sizeof(uint32_t) + read_size(p);
+        }
+        return fmt::string_view(p + sizeof(uint32_t), read_size(p));
+    }
+
+    static uint32_t read_size(const char* p) {
+        uint32_t size;
+        std::memcpy(&size, p, sizeof(size));
+        return size;
+    }
+};
+
+namespace fmt {
+template <>
+struct formatter<preformatted_arg> {
+    template <typename ParseContext>
+    FMT_CONSTEXPR auto parse(ParseContext& ctx) -> decltype(ctx.begin()) {
+        auto it = ctx.begin();
+        auto end = ctx.end();
+        while (it != end && *it != '}') {
+            if (*it++ != '{') {
+                continue;
+            }
+            if (it != end && *it >= '0' && *it <= '9') {
+                int id = 0;
+                while (it != end && *it >= '0' && *it <= '9') {
+                    id = id * 10 + (*it++ - '0');
+                }
+                ctx.check_arg_id(id);
+            } else if (it != end && *it == '}') {
+                ctx.next_arg_id();
+            }
+            while (it != end && *it != '}') {
+                ++it;
+            }
+            if (it != end) {
+                ++it;
+            }
+        }
+        return it;
+    }
+
+    template <typename FormatContext>
+    auto format(const preformatted_arg& arg, FormatContext& ctx) const -> decltype(ctx.out()) {
+        fmt::string_view text = arg.get();
+        return std::copy(text.data(), text.data() + text.size(), ctx.out());
+    }
+};
+}
+
+// fmt 参数访问器：按 fmt 内部的类型把参数写入缓冲区。
+// args、index 和 format 只在生产者端格式化自定义类型时用到
+template <typename Buffer>
+class arg_packer {
+public:
+    arg_packer(Buffer& buf, fmt::format_args args, int index, fmt::string_view format, bool is_static = false)
+        : buf_(buf), args_(args), index_(index), format_(format), is_static_(is_static) {}
+
+    void operator()(int v) { put(packed_type::int32, v); }
+    void operator()(unsigned v) { put(packed_type::uint32, v); }
+    void operator()(long long v) { put(packed_type::int64, v); }
+    void operator()(unsigned long long v) { put(packed_type::uint64, v); }
+    void operator()(bool v) { put(packed_type::boolean, v); }
+    void operator()(char v) { put(packed_type::character, v); }
+    void operator()(float v) { put(packed_type::float32, v); }
+    void operator()(double v) { put(packed_type::float64, v); }
+    void operator()(long double v) { put(packed_type::long_double, v); }
+    void operator()(const void* v) { put(packed_type::pointer, v); }
+
+    void operator()(const char* v) {
+        put_string(fmt::string_view(v ? v : ""));
+    }
+
+    void operator()(fmt::string_view v) {
+        if (is_static_) {
+            put_static(v);
+        } else {
+            put_string(v);
+        }
+    }
+
+    // 自定义类型等无法按值保存的参数，在生产者端按格式串里对应的替换域（连同格式说明符）格式化，
+    // 消费者端不能再对格式化结果套用 {:x}、{:.3f} 这类只对原类型有效的说明符
+    template <typename T>
+    void operator()(const T&) {
+        packed_type type = packed_type::formatted;
+        pack_raw(buf_, &type, sizeof(type));
+        size_t count_offset = buf_.size();
+        uint32_t count = 0;
+        pack_raw(buf_, &count, sizeof(count));
+        fmt::memory_buffer str;
+        count = for_each_replacement_field(format_, index_, [&](fmt::string_view field) {
+            str.clear();
+            fmt::vformat_to(std::back_inserter(str), field, args_);
+            pack_string(buf_, fmt::string_view(str.data(), str.size()));
+        });
+        std::memcpy(&buf_[count_offset], &count, sizeof(count));
+    }
+
+private:
+    // 类型标签和定长部分先在栈上拼好，每个参数只向缓冲追加一到两次
+    template <typename T>
+    void put(packed_type type, const T& value) {
+        char bytes[sizeof(type) + sizeof(value)];
+        std::memcpy(bytes, &type, sizeof(type));
+        std::memcpy(bytes + sizeof(type), &value, sizeof(value));
+        pack_raw(buf_, bytes, sizeof(bytes));
+    }
+
+    void put_string(fmt::string_view str) {
+        packed_type type = packed_type::string;
+        uint32_t size = static_cast<uint32_t>(str.size());
+        char bytes[sizeof(type) + sizeof(size)];
+        std::memcpy(bytes, &type, sizeof(type));
+        std::memcpy(bytes + sizeof(type), &size, sizeof(size));
+        pack_raw(buf_, bytes, sizeof(bytes));
+        pack_raw(buf_, str.data(), str.size());
+    }
+
+    void put_static(fmt::string_view str) {
+        packed_type type = packed_type::static_string;
+        const char* data = str.data();
+        uint32_t size = static_cast<uint32_t>(str.size());
+        char bytes[sizeof(type) + sizeof(data) + sizeof(size)];
+        std::memcpy(bytes, &type, sizeof(type));
+        std::memcpy(bytes + sizeof(type), &data, sizeof(data));
+        std::memcpy(bytes + sizeof(type) + sizeof(data), &size, sizeof(size));
+        pack_raw(buf_, bytes, sizeof(bytes));
+    }
+
+    Buffer& buf_;
+    fmt::format_args args_;
+    int index_;
+    fmt::string_view format_;
+    bool is_static_;
+};
+
+// 打包 args 中的第 index 个参数；format 是使用这些参数的格式串，没有时（如字段值）自定义类型按 "{}" 格式化
+template <typename Buffer>
+inline void pack_arg(Buffer& buf, fmt::format_args args, int index, fmt::string_view format = fmt::string_view(),
+                     bool is_static = false) {
+    auto arg = args.get(index);
+#ifdef FMT_BASE_H_
+    arg.visit(arg_packer<Buffer>(buf, args, index, format, is_static));
+#else
+    fmt::visit_format_arg(arg_packer<Buffer>(buf, args, index, format, is_static), arg);
+#endif
+}
+
+// static_args 为 static_arg_mask 的结果，对应的参数只打包指针；
+// 落盘等跨进程的格式不能使用，保持默认的 0。format 用来找出自定义类型参数的格式说明符
+template <typename Buffer>
+inline void pack_args(Buffer& buf, fmt::string_view format, fmt::format_args args, uint64_t static_args = 0) {
+    for (int i = 0; args.get(i); ++i) {
+        pack_arg(buf, args, i, format, i < 64 && (static_args >> i & 1));
+    }
+}
+
+template <typename T>
+inline T unpack_raw(const char*& p, const char* end) {
+    if (static_cast<size_t>(end - p) < sizeof(T)) {
+        throw std::runtime_error("打包数据被截断");
+    }
+    T value;
+    std::memcpy(&value, p, sizeof(value));
+    p += sizeof(value);
+    return value;
+}
+
+// 返回的 string_view 直接指向记录内部，不做拷贝
+inline fmt::string_view unpack_string(const char*& p, const char* end) {
+    uint32_t size = unpack_raw<uint32_t>(p, end);
+    if (static_cast<size_t>(end - p) < size) {
+        throw std::runtime_error("打包数据被截断");
+    }
+    fmt::string_view str(p, size);
+    p += size;
+    return str;
+}
+
+// 解包一个参数到 dynamic_format_arg_store，字符串以视图形式加入。
+// static_string 只存了本进程内的指针，来自文件等外部的数据要传 allow_static = false 拒绝它
+inline void unpack_arg(const char*& p, const char* end, fmt::dynamic_format_arg_store<fmt::format_context>& store,
+                       bool allow_static = true) {
+    packed_type type = unpack_raw<packed_type>(p, end);
+    switch (type) {
+        case packed_type::int32: store.push_back(unpack_raw<int>(p, end)); break;
+        case packed_type::uint32: store.push_back(unpack_raw<unsigned>(p, end)); break;
+        case packed_type::int64: store.push_back(unpack_raw<long long>(p, end)); break;
+        case packed_type::uint64: store.push_back(unpack_raw<unsigned long long>(p, end)); break;
+        // 按字节读，不把任意字节当作 bool 解释
+        case packed_type::boolean: store.push_back(unpack_raw<uint8_t>(p, end) != 0); break;
+        case packed_type::character: store.push_back(unpack_raw<char>(p, end)); break;
+        case packed_type::float32: store.push_back(unpack_raw<float>(p, end)); break;
+        case packed_type::float64: store.push_back(unpack_raw<double>(p, end)); break;
+        case packed_type::long_double: store.push_back(unpack_raw<long double>(p, end)); break;
+        case packed_type::string: store.push_back(unpack_string(p, end)); break;
+        case packed_type::pointer: store.push_back(unpack_raw<const void*>(p, end)); break;
+        case packed_type::static_string: {
+            if (!allow_static) {
+                throw std::runtime_error("外部数据中不允许出现静态字符串参数");
+            }
+            const char* data = unpack_raw<const char*>(p, end);
+            store.push_back(fmt::string_view(data, unpack_raw<uint32_t>(p, end)));
+            break;
+        }
+        case packed_type::formatted: {
+            uint32_t count = unpack_raw<uint32_t>(p, end);
+            if (count == 0 || count > static_cast<size_t>(end - p) / sizeof(uint32_t)) {
+                throw std::runtime_error("打包数据已损坏");
+            }
+            preformatted_arg arg = {p, count, 0};
+            for (uint32_t i = 0; i < count; ++i) {
+                unpack_string(p, end);
+            }
+            store.push_back(arg);
+            break;
+        }
+        default:
+            throw std::runtime_error("无效的参数类型标签");
+    }
+}
+
+// 解包 [p, end) 中的全部参数
+inline void unpack_args(const char* p, const char* end, fmt::dynamic_format_arg_store<fmt::format_context>& store,
+                        bool allow_static = true) {
+    while (p < end) {
+        unpack_arg(p, end, store, allow_static);
+    }
+}
+
+#endif
@@ -0,0 +1,375 @@
+#ifndef BINARY_LOG_H
+#define BINARY_LOG_H
+
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <fmt/format.h>
+#include "ArgPack.h"
+#include "LogFields.h"
+#include "Sinks.h"
+
+// 二进制日志文件格式（NanoLog 风格），格式串只在字典里出现一次：
+//   文件头  "BLOG" + 1 字节版本号。sink 以追加方式打开文件，每次运行都先写一个文件头，
+//          解码到新的文件头时清空全部字典，时间差也从 0 重新开始
+//   'L'    级别字典：u8 级别，字符串 名称
+//   'S'    调用点字典：varint id，u8 级别，字符串 文件，varint 行号，字符串 签名，字符串 格式串
+//   'N'    线程字典：varint tid，字符串 标签（线程改名后重新写出）
+//   'G'    logger 名称字典：varint id（从 1 开始），字符串 名称
+//   'R'    记录：varint 调用点 id，varint tid，varint logger id（0 表示未命名），varint 时间差（zigzag，纳秒），
+//          [id 为 0 时：u8 级别，字符串 格式串]，字符串 参数（ArgPack 格式），
+//          varint 字段数，[字段数大于 0 时：字符串 字段（LogFields 打包格式）]
+//   'T'    纯文本行：字符串
+// 字符串均为 varint 长度 + 字节。
+static const char binary_log_magic[4] = {'B', 'L', 'O', 'G'};
+static const uint8_t binary_log_version = 6;
+
+static const size_t max_varint_size = 10;
+
+// 写到 out 开始的位置，返回写完之后的位置；out 至少要有 max_varint_size 字节
+inline char* encode_varint(char* out, uint64_t value) {
+    while (value >= 0x80) {
+        *out++ = static_cast<char>(value | 0x80);
+        value >>= 7;
+    }
+    *out++ = static_cast<char>(value);
+    return out;
+}
+
+template <typename Buffer>
+inline void put_varint(Buffer& buf, uint64_t value) {
+    char bytes[max_varint_size];
+    buf.append(bytes, encode_varint(bytes, value) - bytes);
+}
+
+template <typename Buffer>
+inline void put_bytes(Buffer& buf, fmt::string_view str) {
+    put_varint(buf, str.size());
+    buf.append(str.data(), str.size());
+}
+
+inline uint64_t zigzag_encode(int64_t value) {
+    return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+
+inline int64_t zigzag_decode(uint64_t value) {
+    return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+// 追加写入，不覆盖上一次运行的日志：新的文件头之后字典全部重新写出
+class binary_file_sink : public base_sink {
+public:
+    binary_file_sink(const std::string& filename)
+        : filename_(filename), levels_written_(0), last_time_ns_(0), last_tid_(0), last_thread_label_(nullptr),
+          last_logger_name_(nullptr), last_logger_id_(0) {
+        file_helper_.open(filename, false);
+        buf_.append(binary_log_magic, sizeof(binary_log_magic));
+        buf_.push_back(static_cast<char>(binary_log_version));
+        file_helper_.write(buf_.data(), buf_.size());
+    }
+
+    bool structured() const override { return true; }
+    bool binary() const override { return true; }
+
+    void log(const std::string& msg) override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        buf_.clear();
+        buf_.push_back('T');
+        put_bytes(buf_, msg);
+        file_helper_.write(buf_.data(), buf_.size());
+    }
+
+    void log_packed(const packed_record& rec) override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        buf_.clear();
+        if (rec.level >= 0 && rec.level < 32 && !(levels_written_ & (1u << rec.level))) {
+            buf_.push_back('L');
+            buf_.push_back(static_cast<char>(rec.level));
+            put_bytes(buf_, rec.level_name);
+            levels_written_ |= 1u << rec.level;
+        }
+        if (rec.site_id != 0) {
+            if (rec.site_id >= sites_written_.size()) {
+                sites_written_.resize(rec.site_id + 1, false);
+            }
+            if (!sites_written_[rec.site_id]) {
+                buf_.push_back('S');
+                put_varint(buf_, rec.site_id);
+                buf_.push_back(static_cast<char>(rec.level));
+                put_bytes(buf_, rec.file);
+                put_varint(buf_, rec.line);
+                put_bytes(buf_, rec.signature);
+                put_bytes(buf_, rec.format);
+                sites_written_[rec.site_id] = true;
+            }
+        }
+        // 连续的记录大多来自同一个线程和 logger，与上一条相同时不查字典
+        if (rec.tid != last_tid_ || rec.thread_label.data() != last_thread_label_) {
+            auto thread = thread_labels_.find(rec.tid);
+            if (thread == thread_labels_.end() || thread->second != rec.thread_label.data()) {
+                buf_.push_back('N');
+                put_varint(buf_, rec.tid);
+                put_bytes(buf_, rec.thread_label);
+                thread_labels_[rec.tid] = rec.thread_label.data();
+            }
+            last_tid_ = rec.tid;
+            last_thread_label_ = rec.thread_label.data();
+        }
+        uint32_t logger_id = 0;
+        if (rec.logger_name.size() != 0) {
+            if (rec.logger_name.data() != last_logger_name_) {
+                auto logger = logger_ids_.find(rec.logger_name.data());
+                if (logger == logger_ids_.end()) {
+                    logger = logger_ids_.emplace(rec.logger_name.data(),
+                                                 static_cast<uint32_t>(logger_ids_.size() + 1)).first;
+                    buf_.push_back('G');
+                    put_varint(buf_, logger->second);
+                    put_bytes(buf_, rec.logger_name);
+                }
+                last_logger_name_ = rec.logger_name.data();
+                last_logger_id_ = logger->second;
+            }
+            logger_id = last_logger_id_;
+        }
+        // 记录头的定长部分先在栈上编码，一次追加
+        char head[1 + 4 * max_varint_size];
+        char* p = head;
+        *p++ = 'R';
+        p = encode_varint(p, rec.site_id);
+        p = encode_varint(p, rec.tid);
+        p = encode_varint(p, logger_id);
+        p = encode_varint(p, zigzag_encode(rec.time_ns - last_time_ns_));
+        buf_.append(head, p - head);
+        last_time_ns_ = rec.time_ns;
+        if (rec.site_id == 0) {
+            buf_.push_back(static_cast<char>(rec.level));
+            put_bytes(buf_, rec.format);
+        }
+        put_bytes(buf_, rec.args);
+        put_varint(buf_, rec.fields.count);
+        if (rec.fields.count > 0) {
+            put_bytes(buf_, rec.packed_fields);
+        }
+        file_helper_.write(buf_.data(), buf_.size());
+    }
+
+    void flush() override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        file_helper_.flush();
+    }
+
+private:
+    std::string filename_;
+    file_helper file_helper_;
+    std::string buf_;
+    std::vector<bool> sites_written_;
+    std::unordered_map<uint32_t, const char*> thread_labels_;
+    std::unordered_map<const char*, uint32_t> logger_ids_; // 按驻留字符串的地址区分 logger
+    uint32_t levels_written_;
+    int64_t last_time_ns_;
+    uint32_t last_tid_;               // 上一条记录的线程和标签，已写进线程字典
+    const char* last_thread_label_;
+    const char* last_logger_name_;    // 上一条记录的 logger 名称及其 id
+    uint32_t last_logger_id_;
+
+    std::mutex mutex_;
+};
+
+// 离线解码：把二进制日志还原为 "[time] [name] [LEVEL] [thread] msg" 文本行，级别始终是完整名称
+class binary_log_reader {
+public:
+    binary_log_reader(std::string data)
+        : data_(std::move(data)), p_(data_.data()), end_(data_.data() + data_.size()), last_time_ns_(0) {
+        if (data_.size() < sizeof(binary_log_magic) + 1 ||
+            data_.compare(0, sizeof(binary_log_magic), binary_log_magic, sizeof(binary_log_magic)) != 0) {
+            throw std::runtime_error("不是二进制日志文件");
+        }
+        read_header();
+    }
+
+    // 解码下一行文本，文件结束时返回 false
+    bool next(std::string& line) {
+        while (p_ < end_) {
+            char type = *p_++;
+            switch (type) {
+                case 'L': {
+                    uint8_t level = read_u8();
+                    levels_[level] = read_string();
+                    break;
+                }
+                case 'S': {
+                    uint32_t id = static_cast<uint32_t>(read_varint());
+                    site_entry& site = sites_[id];
+                    site.level = read_u8();
+                    site.file = read_string();
+                    site.line = static_cast<int>(read_varint());
+                    site.signature = read_string();
+                    site.format = read_string();
+                    break;
+                }
+                case 'N': {
+                    uint32_t tid = static_cast<uint32_t>(read_varint());
+                    threads_[tid] = read_string();
+                    break;
+                }
+                case 'G': {
+                    uint32_t id = static_cast<uint32_t>(read_varint());
+                    loggers_[id] = read_string();
+                    break;
+                }
+                case 'R':
+                    line = read_record();
+                    return true;
+                case 'T':
+                    line = read_string();
+                    return true;
+                case 'B': // 追加写入的下一次运行
+                    --p_;
+                    read_header();
+                    break;
+                default:
+                    throw std::runtime_error("二进制日志已损坏");
+            }
+        }
+        return false;
+    }
+
+private:
+    struct site_entry {
+        uint8_t level;
+        std::string file;
+        int line;
+        std::string signature;
+        std::string format;
+    };
+
+    std::string read_record() {
+        uint32_t id = static_cast<uint32_t>(read_varint());
+        uint32_t tid = static_cast<uint32_t>(read_varint());
+        uint32_t logger_id = static_cast<uint32_t>(read_varint());
+        last_time_ns_ += zigzag_decode(read_varint());
+        uint8_t level;
+        fmt::string_view format;
+        if (id == 0) {
+            level = read_u8();
+            format = read_bytes();
+        } else {
+            auto it = sites_.find(id);
+            if (it == sites_.end()) {
+                throw std::runtime_error("未知的调用点 id");
+            }
+            level = it->second.level;
+            format = it->second.format;
+        }
+        fmt::string_view args = read_bytes();
+        fmt::dynamic_format_arg_store<fmt::format_context> store;
+        // 文件内容不可信：解包时检查边界，并拒绝只在写入进程内有效的静态字符串指针
+        unpack_args(args.data(), args.data() + args.size(), store, false);
+        size_t field_count = static_cast<size_t>(read_varint());
+        std::vector<fmt::string_view> keys;
+        fmt::dynamic_format_arg_store<fmt::format_context> values;
+        if (field_count > 0) {
+            fmt::string_view fields = read_bytes();
+            const char* p = fields.data();
+            const char* end = p + fields.size();
+            unpack_fields(p, end, field_count, keys, values, false);
+            if (p != end) {
+                throw std::runtime_error("二进制日志已损坏");
+            }
+        }
+
+        std::time_t now = static_cast<std::time_t>(last_time_ns_ / 1000000000);
+        char dt[32];
+        if (!ctime_r(&now, dt)) {
+            throw std::runtime_error("二进制日志时间戳无效");
+        }
+        dt[std::strlen(dt) - 1] = '\0'; // 移除换行符
+        auto level_it = levels_.find(level);
+        fmt::string_view level_name = level_it != levels_.end() ? fmt::string_view(level_it->second) : "UNKNOWN";
+        auto thread_it = threads_.find(tid);
+        std::string thread = thread_it != threads_.end() ? thread_it->second : fmt::format_int(tid).str();
+        fmt::memory_buffer buf;
+        fmt::format_to(std::back_inserter(buf), "[{}] ", dt);
+        if (logger_id != 0) {
+            auto logger_it = loggers_.find(logger_id);
+            if (logger_it == loggers_.end()) {
+                throw std::runtime_error("未知的 logger id");
+            }
+            fmt::format_to(std::back_inserter(buf), "[{}] ", logger_it->second);
+        }
+        fmt::format_to(std::back_inserter(buf), "[{}] [{}] ", level_name, thread);
+        fmt::vformat_to(std::back_inserter(buf), format, store);
+        format_fields_text(buf, field_view(keys.data(), values, field_count));
+        buf.push_back('\n');
+        return fmt::to_string(buf);
+    }
+
+    // 文件头之后是一次新的运行，此前的字典和时间基准都不再适用
+    void read_header() {
+        check(sizeof(binary_log_magic) + 1);
+        if (std::memcmp(p_, binary_log_magic, sizeof(binary_log_magic)) != 0) {
+            throw std::runtime_error("二进制日志已损坏");
+        }
+        p_ += sizeof(binary_log_magic);
+        if (static_cast<uint8_t>(*p_++) != binary_log_version) {
+            throw std::runtime_error("不支持的二进制日志版本");
+        }
+        levels_.clear();
+        sites_.clear();
+        threads_.clear();
+        loggers_.clear();
+        last_time_ns_ = 0;
+    }
+
+    uint8_t read_u8() {
+        check(1);
+        return static_cast<uint8_t>(*p_++);
+    }
+
+    uint64_t read_varint() {
+        uint64_t value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            uint8_t byte = read_u8();
+            value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+            if (!(byte & 0x80)) {
+                return value;
+            }
+        }
+        throw std::runtime_error("二进制日志已损坏");
+    }
+
+    std::string read_string() {
+        fmt::string_view str = read_bytes();
+        return std::string(str.data(), str.size());
+    }
+
+    fmt::string_view read_bytes() {
+        uint64_t size = read_varint();
+        check(size);
+        fmt::string_view str(p_, size);
+        p_ += size;
+        return str;
+    }
+
+    void check(uint64_t size) const {
+        if (size > static_cast<uint64_t>(end_ - p_)) {
+            throw std::runtime_error("二进制日志被截断");
+        }
+    }
+
+    std::string data_;
+    const char* p_;
+    const char* end_;
+    int64_t last_time_ns_;
+    std::unordered_map<uint8_t, std::string> levels_;
+    std::unordered_map<uint32_t, site_entry> sites_;
+    std::unordered_map<uint32_t, std::string> threads_;
+    std::unordered_map<uint32_t, std::string> loggers_;
+};
+
+#endif
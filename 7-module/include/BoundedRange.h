@@ -0,0 +1,125 @@
+#ifndef BOUNDED_RANGE_H
+#define BOUNDED_RANGE_H
+
+#include <cstddef>
+#include <iterator>
+#include <fmt/format.h>
+#include <fmt/ranges.h>
+
+// 有上限的容器参数：
+//   LOG_INFO(logger, "候选：{}", bounded(ids));            // [1, 2, 3, ... (+999997 more)]
+//   LOG_INFO(logger, "配置：{}", bounded(config, 16, 1024)); // {a: 1, b: 2, ... (+30 more)}
+// 最多输出 max_items 个元素、max_bytes 字节的元素文本，其余只报告个数；
+// 没有 size() 的范围（如 forward_list）不为数个数而走完全程，只输出 "... (+more)"。
+// 只保存容器的引用；异步路径在生产者线程打包参数时就按上限格式化成字符串，
+// 既不拷贝整个容器，也不会让一个大容器拖住工作线程。
+// 元素本身按 "{}" 格式化（嵌套容器、pair 由 fmt/ranges.h 支持），单个元素不截断。
+template <typename Range>
+class bounded_range {
+public:
+    bounded_range(const Range& range, size_t max_items, size_t max_bytes)
+        : range_(range), max_items_(max_items), max_bytes_(max_bytes) {}
+
+    const Range& range() const { return range_; }
+    size_t max_items() const { return max_items_; }
+    size_t max_bytes() const { return max_bytes_; }
+
+private:
+    const Range& range_;
+    size_t max_items_;
+    size_t max_bytes_;
+};
+
+template <typename Range>
+inline bounded_range<Range> bounded(const Range& range, size_t max_items = 64, size_t max_bytes = 4096) {
+    return bounded_range<Range>(range, max_items, max_bytes);
+}
+
+namespace bounded_detail {
+// next 是第一个没有输出的元素。有 size() 的容器（C++11 起都是常数时间）直接算出剩余个数写出；
+// 没有的只看 next 是否已到末尾，不再往后数
+template <typename Range, typename Iterator>
+inline auto write_remaining(fmt::memory_buffer& buf, const Range& range, Iterator next, size_t written, int)
+    -> decltype(static_cast<size_t>(range.size()), void()) {
+    if (next != std::end(range)) {
+        fmt::format_to(std::back_inserter(buf), "{}... (+{} more)", written > 0 ? ", " : "",
+                       static_cast<size_t>(range.size()) - written);
+    }
+}
+
+template <typename Range, typename Iterator>
+inline void write_remaining(fmt::memory_buffer& buf, const Range& range, Iterator next, size_t written, long) {
+    if (next != std::end(range)) {
+        fmt::format_to(std::back_inserter(buf), "{}... (+more)", written > 0 ? ", " : "");
+    }
+}
+
+// 原生数组没有 size()，元素个数在类型里
+template <typename T, size_t N, typename Iterator>
+inline void write_remaining(fmt::memory_buffer& buf, const T (&)[N], Iterator, size_t written, int) {
+    if (written < N) {
+        fmt::format_to(std::back_inserter(buf), "{}... (+{} more)", written > 0 ? ", " : "", N - written);
+    }
+}
+
+// 有 mapped_type 的按 {k: v} 输出，与 fmt/ranges.h 对 map 的写法一致
+template <typename Range>
+inline constexpr bool is_map(typename Range::mapped_type*) { return true; }
+
+template <typename Range>
+inline constexpr bool is_map(...) { return false; }
+
+template <typename T>
+inline void write_element(fmt::memory_buffer& buf, const T& value, std::false_type) {
+    fmt::format_to(std::back_inserter(buf), "{}", value);
+}
+
+template <typename T>
+inline void write_element(fmt::memory_buffer& buf, const T& value, std::true_type) {
+    fmt::format_to(std::back_inserter(buf), "{}: {}", value.first, value.second);
+}
+}
+
+namespace fmt {
+template <typename Range>
+struct formatter<bounded_range<Range>> {
+    template <typename ParseContext>
+    FMT_CONSTEXPR auto parse(ParseContext& ctx) -> decltype(ctx.begin()) {
+        return ctx.begin();
+    }
+
+    // 先写进本地缓冲，超出字节上限的那个元素整体回退
+    template <typename FormatContext>
+    auto format(const bounded_range<Range>& arg, FormatContext& ctx) const -> decltype(ctx.out()) {
+        typedef std::integral_constant<bool, bounded_detail::is_map<Range>(nullptr)> map_tag;
+        const char* open = map_tag::value ? "{" : "[";
+        const char* close = map_tag::value ? "}" : "]";
+        memory_buffer buf;
+        buf.append(string_view(open));
+        size_t written = 0;
+        size_t element_bytes = 0;
+        auto it = std::begin(arg.range());
+        for (; it != std::end(arg.range()); ++it) {
+            if (written == arg.max_items()) {
+                break;
+            }
+            size_t before = buf.size();
+            if (written > 0) {
+                buf.append(string_view(", "));
+            }
+            bounded_detail::write_element(buf, *it, map_tag());
+            element_bytes += buf.size() - before;
+            if (element_bytes > arg.max_bytes()) {
+                buf.resize(before);
+                break;
+            }
+            ++written;
+        }
+        bounded_detail::write_remaining(buf, arg.range(), it, written, 0);
+        buf.append(string_view(close));
+        return std::copy(buf.begin(), buf.end(), ctx.out());
+    }
+};
+}
+
+#endif
@@ -0,0 +1,241 @@
+#ifndef COMPRESS_SINK_H
+#define COMPRESS_SINK_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <zlib.h>
+#ifdef LOGGER_HAS_ZSTD
+#include <zstd.h>
+#endif
+#include <fmt/core.h>
+#include "Sinks.h"
+#include "ThreadPool.h"
+
+// 压缩格式。deflate 写成 gzip 成员，zstd 写成 zstd 帧；两者首尾相接都仍是合法文件，
+// zcat / zstdcat 可以直接解开整个文件。zstd 需要编译时定义 LOGGER_HAS_ZSTD 并链接 -lzstd
+enum class compression_codec {
+    deflate,
+    zstd
+};
+
+// 把一批文本压成一个独立的帧，每帧都从空字典开始，解压时不依赖前面的帧
+class frame_compressor {
+public:
+    // level 为 -1 时使用各自的默认级别（deflate 6，zstd 3）
+    frame_compressor(compression_codec codec, int level) : codec_(codec) {
+        if (codec == compression_codec::deflate) {
+            std::memset(&zs_, 0, sizeof(zs_));
+            // windowBits 加 16 表示写 gzip 头和尾
+            if (deflateInit2(&zs_, level, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+                throw std::runtime_error("初始化 deflate 失败");
+            }
+            return;
+        }
+#ifdef LOGGER_HAS_ZSTD
+        cctx_ = ZSTD_createCCtx();
+        if (!cctx_) {
+            throw std::runtime_error("初始化 zstd 失败");
+        }
+        ZSTD_CCtx_setParameter(cctx_, ZSTD_c_compressionLevel, level == -1 ? ZSTD_CLEVEL_DEFAULT : level);
+#else
+        throw std::runtime_error("未启用 zstd 支持，编译时需要定义 LOGGER_HAS_ZSTD 并链接 -lzstd");
+#endif
+    }
+
+    frame_compressor(const frame_compressor&) = delete;
+    frame_compressor& operator=(const frame_compressor&) = delete;
+
+    ~frame_compressor() {
+        if (codec_ == compression_codec::deflate) {
+            deflateEnd(&zs_);
+        }
+#ifdef LOGGER_HAS_ZSTD
+        else {
+            ZSTD_freeCCtx(cctx_);
+        }
+#endif
+    }
+
+    // 压缩结果覆盖 out，输出缓冲按最坏情况预留，一次调用完成
+    void compress(const char* data, size_t size, std::string& out) {
+        if (codec_ == compression_codec::deflate) {
+            deflateReset(&zs_);
+            out.resize(deflateBound(&zs_, static_cast<uLong>(size)));
+            zs_.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+            zs_.avail_in = static_cast<uInt>(size);
+            zs_.next_out = reinterpret_cast<Bytef*>(&out[0]);
+            zs_.avail_out = static_cast<uInt>(out.size());
+            if (deflate(&zs_, Z_FINISH) != Z_STREAM_END) {
+                throw std::runtime_error("deflate 压缩失败");
+            }
+            out.resize(zs_.total_out);
+            return;
+        }
+#ifdef LOGGER_HAS_ZSTD
+        out.resize(ZSTD_compressBound(size));
+        size_t n = ZSTD_compress2(cctx_, &out[0], out.size(), data, size);
+        if (ZSTD_isError(n)) {
+            throw std::runtime_error(std::string("zstd 压缩失败：") + ZSTD_getErrorName(n));
+        }
+        out.resize(n);
+#endif
+    }
+
+private:
+    compression_codec codec_;
+    z_stream zs_;
+#ifdef LOGGER_HAS_ZSTD
+    ZSTD_CCtx* cctx_ = nullptr;
+#endif
+};
+
+// 压缩写入的文本文件 sink：写日志的线程只把文本追加到当前批次，攒满 frame_size 后整批交给
+// sink 自己的压缩线程，压成独立的一帧后立即写出。压缩线程上同时只有一帧，下一批攒满时
+// 写日志的线程先等上一帧写完再交出去，所以进程崩溃时丢失的只有正在攒的批次和至多一帧正在压缩的数据。
+// 压缩或写入失败不影响继续写日志，由下一次 flush 抛出
+class compressed_file_sink : public base_sink {
+public:
+    struct compression_stats {
+        uint64_t frames;
+        uint64_t input_bytes;   // 压缩前的字节数
+        uint64_t output_bytes;  // 写入文件的字节数
+        uint64_t compress_ns;   // 压缩线程花在压缩上的时间
+    };
+
+    static const size_t default_frame_size = 1024 * 1024;
+
+    compressed_file_sink(const std::string& filename, compression_codec codec = compression_codec::deflate,
+                         int level = -1, size_t frame_size = default_frame_size)
+        : filename_(filename), frame_size_(frame_size), compressor_(codec, level), frames_(0), input_bytes_(0),
+          output_bytes_(0), compress_ns_(0) {
+        file_helper_.open(filename, false);
+        batch_.reserve(frame_size_);
+        worker_.reset(new ThreadPool(1));
+    }
+
+    // 剩余的批次压完写出后再关闭文件
+    ~compressed_file_sink() {
+        try {
+            std::lock_guard<std::mutex> lock(mutex_);
+            submit();
+        } catch (const std::exception&) {
+            // 析构时无处报告失败
+        }
+        worker_.reset();
+    }
+
+    void log(const std::string& msg) override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        fmt::string_view line = checked_utf8(msg);
+        batch_.append(line.data(), line.size());
+        if (batch_.size() >= frame_size_) {
+            submit();
+        }
+    }
+
+    bool fragments() const override { return true; }
+
+    void log_fragments(const fmt::string_view* parts, size_t count) override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        fmt::string_view line;
+        if (checked_utf8(parts, count, line)) {
+            parts = &line;
+            count = 1;
+        }
+        for (size_t i = 0; i < count; ++i) {
+            batch_.append(parts[i].data(), parts[i].size());
+        }
+        if (batch_.size() >= frame_size_) {
+            submit();
+        }
+    }
+
+    // 不满一帧的批次也压成一帧写出，并等待它写完；此前压缩或写入的失败在这里抛出
+    void flush() override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        submit();
+        wait_in_flight();
+        std::exception_ptr error;
+        error.swap(error_);
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+
+    compression_stats stats() const {
+        compression_stats stats;
+        stats.frames = frames_.load(std::memory_order_relaxed);
+        stats.input_bytes = input_bytes_.load(std::memory_order_relaxed);
+        stats.output_bytes = output_bytes_.load(std::memory_order_relaxed);
+        stats.compress_ns = compress_ns_.load(std::memory_order_relaxed);
+        return stats;
+    }
+
+private:
+    // 需要持有 mutex_。先等上一帧写完，再把批次的所有权转给压缩线程
+    void submit() {
+        if (batch_.empty()) {
+            return;
+        }
+        wait_in_flight();
+        std::string batch;
+        batch.swap(batch_);
+        batch_.reserve(frame_size_);
+        in_flight_ = worker_->enqueue(&compressed_file_sink::write_frame, this, std::move(batch));
+    }
+
+    // 需要持有 mutex_。失败留到 flush 时抛出
+    void wait_in_flight() {
+        if (!in_flight_.valid()) {
+            return;
+        }
+        try {
+            in_flight_.get();
+        } catch (...) {
+            if (!error_) {
+                error_ = std::current_exception();
+            }
+        }
+    }
+
+    // 只在压缩线程上运行，compressor_、frame_ 和 file_helper_ 归它独占
+    void write_frame(const std::string& batch) {
+        auto start = std::chrono::steady_clock::now();
+        compressor_.compress(batch.data(), batch.size(), frame_);
+        compress_ns_.fetch_add(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                   std::chrono::steady_clock::now() - start).count()),
+                               std::memory_order_relaxed);
+        file_helper_.write(frame_.data(), frame_.size());
+        file_helper_.flush();
+        frames_.fetch_add(1, std::memory_order_relaxed);
+        input_bytes_.fetch_add(batch.size(), std::memory_order_relaxed);
+        output_bytes_.fetch_add(frame_.size(), std::memory_order_relaxed);
+    }
+
+    std::string filename_;
+    size_t frame_size_;
+    std::string batch_;
+    std::future<void> in_flight_;  // 压缩线程上尚未确认写出的帧
+    std::exception_ptr error_;     // 失败的帧，留到 flush 时抛出
+
+    frame_compressor compressor_;
+    std::string frame_;
+    file_helper file_helper_;
+    std::atomic<uint64_t> frames_;
+    std::atomic<uint64_t> input_bytes_;
+    std::atomic<uint64_t> output_bytes_;
+    std::atomic<uint64_t> compress_ns_;
+    std::unique_ptr<ThreadPool> worker_;  // 压缩线程，析构时先停下它
+
+    std::mutex mutex_;
+};
+
+#endif
@@ -0,0 +1,130 @@
+#ifndef DURABLE_SINK_H
+#define DURABLE_SINK_H
+
+#include <cerrno>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <unistd.h>
+#include <fmt/core.h>
+#include "Sinks.h"
+
+// 需要落盘确认的文本文件 sink（审计日志等）。写入与 file_sink 相同，只进用户态缓冲；
+// 需要确认时先取一张票据再等待：
+//   LOG_ERROR(audit, "转账 {} 已受理", id);
+//   audit_sink->wait(audit_sink->ticket());   // 或 audit_sink->sync()
+// 票据是到目前为止写入的记录数，wait 返回时这些记录都已 fdatasync。
+// 组提交：同一时刻只有一个等待者执行 fdatasync，其间新来的等待者不各自同步，
+// 而是由下一次 fdatasync 一并覆盖，并发等待者越多，每次落盘确认的记录越多。
+// 等待要在 Logger 的锁外进行，所以不要用 flush_on 或写入量阈值触发（那只是 flush，写到内核为止）。
+// 只能用于同步 Logger：票据只统计已经交到 sink 的记录，挂在 AsyncLogger 上时日志调用返回后
+// 记录可能还在队列里，wait(ticket()) 会在它写入之前返回，所以 add_sink 会直接拒绝。
+// fdatasync 失败后数据是否落盘无法确定，错误会一直保留，之后所有等待都抛出异常
+class durable_file_sink : public base_sink {
+public:
+    durable_file_sink(const std::string& filename, size_t buffer_size = file_helper::default_buffer_size)
+        : filename_(filename), file_helper_(buffer_size), written_(0), synced_(0), syncs_(0), syncing_(false) {
+        file_helper_.open(filename, false);
+    }
+
+    // 等进行中的 fdatasync 结束后再关闭文件
+    ~durable_file_sink() {
+        std::unique_lock<std::mutex> lock(mutex_);
+        synced_cv_.wait(lock, [this] { return !syncing_; });
+    }
+
+    void log(const std::string& msg) override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        fmt::string_view line = checked_utf8(msg);
+        file_helper_.write(line.data(), line.size());
+        ++written_;
+    }
+
+    bool fragments() const override { return true; }
+
+    bool synchronous() const override { return true; }
+
+    void log_fragments(const fmt::string_view* parts, size_t count) override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        fmt::string_view line;
+        if (checked_utf8(parts, count, line)) {
+            file_helper_.write(line.data(), line.size());
+        } else {
+            file_helper_.write_fragments(parts, count);
+        }
+        ++written_;
+    }
+
+    // 只写到内核，不等落盘
+    void flush() override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        file_helper_.flush();
+    }
+
+    // 到目前为止写入的记录数，作为 wait 的票据
+    uint64_t ticket() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return written_;
+    }
+
+    // 阻塞到票据之前的记录全部 fdatasync。没有进行中的同步时由当前线程执行，
+    // 否则等它结束；它没有覆盖到的票据由下一个领头的等待者连同新记录一起同步
+    void wait(uint64_t ticket) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (synced_ < ticket) {
+            if (!error_.empty()) {
+                throw std::runtime_error(error_);
+            }
+            if (syncing_) {
+                synced_cv_.wait(lock);
+                continue;
+            }
+            uint64_t target = written_;
+            file_helper_.flush();
+            int fd = file_helper_.fd();
+            syncing_ = true;
+            lock.unlock();
+            int rc;
+            do {
+                rc = fdatasync(fd);
+            } while (rc != 0 && errno == EINTR);
+            int err = rc != 0 ? errno : 0;
+            lock.lock();
+            syncing_ = false;
+            ++syncs_;
+            if (rc == 0) {
+                synced_ = target;
+            } else {
+                error_ = "同步日志文件失败：" + filename_ + "：" + std::strerror(err);
+            }
+            synced_cv_.notify_all();
+        }
+    }
+
+    void sync() {
+        wait(ticket());
+    }
+
+    // 已执行的 fdatasync 次数
+    uint64_t syncs() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return syncs_;
+    }
+
+private:
+    std::string filename_;
+    file_helper file_helper_;
+    uint64_t written_;  // 已写入的记录数
+    uint64_t synced_;   // 已确认落盘的记录数
+    uint64_t syncs_;
+    bool syncing_;      // 有线程正在锁外 fdatasync
+    std::string error_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable synced_cv_;
+};
+
+#endif
@@ -0,0 +1,143 @@
+#ifndef ESCAPE_H
+#define ESCAPE_H
+
+#include <cstddef>
+#include <fmt/format.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+// 字符串转义：先批量查找第一个需要转义的字节，之间的干净片段整段拷贝。
+// 查找按 16/32 字节一组用 SSE2/AVX2 比较，运行时按 CPU 选择，不支持时走逐字节版本。
+//
+// 需要转义的字节集合 = 小于 below 的字节 + a + b
+struct escape_class {
+    unsigned char below;
+    unsigned char a;
+    unsigned char b;
+    const char* hex_prefix;  // 其他字节写成 hex_prefix 加两位十六进制
+};
+
+// JSON 字符串：控制字符、引号和反斜杠
+static const escape_class json_escape_class = {0x20, '"', '\\', "\\u00"};
+// 终端输出：控制字符和 DEL，防止不可信字符串注入换行或终端控制序列
+static const escape_class control_escape_class = {0x20, 0x7f, 0x7f, "\\x"};
+
+typedef const char* (*escape_scan_fn)(const char*, const char*, const escape_class&);
+
+inline bool needs_escape(unsigned char c, const escape_class& cls) {
+    return c < cls.below || c == cls.a || c == cls.b;
+}
+
+// 返回 [p, end) 中第一个需要转义的字节，没有则返回 end
+inline const char* find_escape_scalar(const char* p, const char* end, const escape_class& cls) {
+    for (; p != end; ++p) {
+        if (needs_escape(static_cast<unsigned char>(*p), cls)) {
+            return p;
+        }
+    }
+    return end;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+// 无符号的 c < below 用 min(c, below - 1) == c 判断
+__attribute__((target("sse2")))
+inline const char* find_escape_sse2(const char* p, const char* end, const escape_class& cls) {
+    const __m128i below = _mm_set1_epi8(static_cast<char>(cls.below - 1));
+    const __m128i a = _mm_set1_epi8(static_cast<char>(cls.a));
+    const __m128i b = _mm_set1_epi8(static_cast<char>(cls.b));
+    for (; end - p >= 16; p += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        __m128i hit = _mm_or_si128(_mm_cmpeq_epi8(_mm_min_epu8(v, below), v),
+                                   _mm_or_si128(_mm_cmpeq_epi8(v, a), _mm_cmpeq_epi8(v, b)));
+        int mask = _mm_movemask_epi8(hit);
+        if (mask != 0) {
+            return p + __builtin_ctz(mask);
+        }
+    }
+    return find_escape_scalar(p, end, cls);
+}
+
+__attribute__((target("avx2")))
+inline const char* find_escape_avx2(const char* p, const char* end, const escape_class& cls) {
+    const __m256i below = _mm256_set1_epi8(static_cast<char>(cls.below - 1));
+    const __m256i a = _mm256_set1_epi8(static_cast<char>(cls.a));
+    const __m256i b = _mm256_set1_epi8(static_cast<char>(cls.b));
+    for (; end - p >= 32; p += 32) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        __m256i hit = _mm256_or_si256(_mm256_cmpeq_epi8(_mm256_min_epu8(v, below), v),
+                                      _mm256_or_si256(_mm256_cmpeq_epi8(v, a), _mm256_cmpeq_epi8(v, b)));
+        unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(hit));
+        if (mask != 0) {
+            return p + __builtin_ctz(mask);
+        }
+    }
+    return find_escape_sse2(p, end, cls);
+}
+#endif
+
+inline escape_scan_fn resolve_escape_scan() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return find_escape_avx2;
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        return find_escape_sse2;
+    }
+#endif
+    return find_escape_scalar;
+}
+
+inline const char* find_escape(const char* p, const char* end, const escape_class& cls) {
+    static const escape_scan_fn scan = resolve_escape_scan();
+    return scan(p, end, cls);
+}
+
+// 把 str 转义后追加到 buf，scan 可指定查找实现（校验和基准测试用）
+template <typename Buffer>
+inline void escape_to(Buffer& buf, fmt::string_view str, const escape_class& cls,
+                      escape_scan_fn scan = find_escape) {
+    static const char hex[] = "0123456789abcdef";
+    const char* p = str.data();
+    const char* end = p + str.size();
+    for (;;) {
+        const char* hit = scan(p, end, cls);
+        buf.append(p, hit);
+        if (hit == end) {
+            break;
+        }
+        unsigned char c = static_cast<unsigned char>(*hit);
+        char escaped[8] = {'\\'};
+        size_t size = 2;
+        switch (c) {
+            case '"': escaped[1] = '"'; break;
+            case '\\': escaped[1] = '\\'; break;
+            case '\n': escaped[1] = 'n'; break;
+            case '\r': escaped[1] = 'r'; break;
+            case '\t': escaped[1] = 't'; break;
+            default: {
+                size = 0;
+                for (const char* prefix = cls.hex_prefix; *prefix; ++prefix) {
+                    escaped[size++] = *prefix;
+                }
+                escaped[size++] = hex[c >> 4];
+                escaped[size++] = hex[c & 0xf];
+            }
+        }
+        buf.append(escaped, escaped + size);
+        p = hit + 1;
+    }
+}
+
+template <typename Buffer>
+inline void json_escape(Buffer& buf, fmt::string_view str) {
+    escape_to(buf, str, json_escape_class);
+}
+
+template <typename Buffer>
+inline void escape_control(Buffer& buf, fmt::string_view str) {
+    escape_to(buf, str, control_escape_class);
+}
+
+#endif
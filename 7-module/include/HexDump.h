@@ -0,0 +1,186 @@
+#ifndef HEX_DUMP_H
+#define HEX_DUMP_H
+
+#include <cstddef>
+#include <cstdint>
+#include <fmt/format.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+// 二进制数据转十六进制：
+//   LOG_INFO(logger, "收到 {}", hex(packet, size));          // 0a1b2c...
+//   logger->log_hex(Logger::DEBUG, "收到", packet, size, hex_layout::canonical);
+// 紧凑写法按 16/32 字节一组用 SSSE3/AVX2 查表（pshufb 把半字节映射成字符），
+// 运行时按 CPU 选择；canonical 写法与 hexdump -C -v 相同（偏移、两组各 8 字节、ASCII 列）。
+// 超过 max_bytes 的部分不输出，只报告剩余字节数。
+enum class hex_layout {
+    compact,   // 0a1b2c...
+    canonical  // 00000000  0a 1b 2c ...  |..,|
+};
+
+typedef void (*hex_encode_fn)(const unsigned char*, size_t, char*);
+
+static const char hex_digits[] = "0123456789abcdef";
+
+// 把 size 个字节写成 2 * size 个十六进制字符
+inline void hex_encode_scalar(const unsigned char* src, size_t size, char* dst) {
+    for (size_t i = 0; i < size; ++i) {
+        dst[2 * i] = hex_digits[src[i] >> 4];
+        dst[2 * i + 1] = hex_digits[src[i] & 0xf];
+    }
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+__attribute__((target("ssse3")))
+inline void hex_encode_ssse3(const unsigned char* src, size_t size, char* dst) {
+    const __m128i table = _mm_loadu_si128(reinterpret_cast<const __m128i*>(hex_digits));
+    const __m128i mask = _mm_set1_epi8(0x0f);
+    size_t i = 0;
+    for (; i + 16 <= size; i += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        __m128i hi = _mm_shuffle_epi8(table, _mm_and_si128(_mm_srli_epi16(v, 4), mask));
+        __m128i lo = _mm_shuffle_epi8(table, _mm_and_si128(v, mask));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 2 * i), _mm_unpacklo_epi8(hi, lo));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 2 * i + 16), _mm_unpackhi_epi8(hi, lo));
+    }
+    hex_encode_scalar(src + i, size - i, dst + 2 * i);
+}
+
+// unpack 只在 128 位的半边内交错，写出前用 permute2x128 把两半按顺序拼回
+__attribute__((target("avx2")))
+inline void hex_encode_avx2(const unsigned char* src, size_t size, char* dst) {
+    const __m256i table = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(hex_digits)));
+    const __m256i mask = _mm256_set1_epi8(0x0f);
+    size_t i = 0;
+    for (; i + 32 <= size; i += 32) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+        __m256i hi = _mm256_shuffle_epi8(table, _mm256_and_si256(_mm256_srli_epi16(v, 4), mask));
+        __m256i lo = _mm256_shuffle_epi8(table, _mm256_and_si256(v, mask));
+        __m256i a = _mm256_unpacklo_epi8(hi, lo);
+        __m256i b = _mm256_unpackhi_epi8(hi, lo);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + 2 * i), _mm256_permute2x128_si256(a, b, 0x20));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + 2 * i + 32), _mm256_permute2x128_si256(a, b, 0x31));
+    }
+    hex_encode_ssse3(src + i, size - i, dst + 2 * i);
+}
+#endif
+
+inline hex_encode_fn resolve_hex_encode() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return hex_encode_avx2;
+    }
+    if (__builtin_cpu_supports("ssse3")) {
+        return hex_encode_ssse3;
+    }
+#endif
+    return hex_encode_scalar;
+}
+
+inline void hex_encode(const unsigned char* src, size_t size, char* dst) {
+    static const hex_encode_fn encode = resolve_hex_encode();
+    encode(src, size, dst);
+}
+
+// canonical 的一行："%08x  " + 16 个 "xx "（第 8 个后多一个空格）+ " |ASCII|"，不足 16 字节时十六进制列补空格
+template <typename Buffer>
+inline void hex_canonical_line(Buffer& buf, const unsigned char* src, size_t size, size_t offset,
+                               hex_encode_fn encode) {
+    char line[80];
+    char hex[32];
+    encode(src, size, hex);
+    for (int shift = 28, i = 0; shift >= 0; shift -= 4, ++i) {
+        line[i] = hex_digits[(offset >> shift) & 0xf];
+    }
+    char* p = line + 8;
+    *p++ = ' ';
+    for (size_t i = 0; i < 16; ++i) {
+        if (i % 8 == 0) {
+            *p++ = ' ';
+        }
+        if (i < size) {
+            *p++ = hex[2 * i];
+            *p++ = hex[2 * i + 1];
+        } else {
+            *p++ = ' ';
+            *p++ = ' ';
+        }
+        *p++ = ' ';
+    }
+    *p++ = ' ';
+    *p++ = '|';
+    for (size_t i = 0; i < size; ++i) {
+        *p++ = src[i] >= 0x20 && src[i] < 0x7f ? static_cast<char>(src[i]) : '.';
+    }
+    *p++ = '|';
+    *p++ = '\n';
+    buf.append(line, p);
+}
+
+// 把 [data, data + size) 的前 max_bytes 个字节追加到 buf，encode 可指定实现（校验和基准测试用）。
+// canonical 写法以总长度的偏移行结尾（与 hexdump -C 相同），末尾不带换行
+template <typename Buffer>
+inline void hex_to(Buffer& buf, const void* data, size_t size, hex_layout layout = hex_layout::compact,
+                   size_t max_bytes = SIZE_MAX, hex_encode_fn encode = hex_encode) {
+    const unsigned char* src = static_cast<const unsigned char*>(data);
+    size_t shown = size < max_bytes ? size : max_bytes;
+    if (layout == hex_layout::compact) {
+        size_t offset = buf.size();
+        buf.resize(offset + 2 * shown);
+        if (shown > 0) {
+            encode(src, shown, &buf[offset]);
+        }
+    } else {
+        buf.reserve(buf.size() + (shown + 15) / 16 * 79 + 8);
+        for (size_t offset = 0; offset < shown; offset += 16) {
+            size_t line = shown - offset < 16 ? shown - offset : 16;
+            hex_canonical_line(buf, src + offset, line, offset, encode);
+        }
+        char end[8];
+        for (int shift = 28, i = 0; shift >= 0; shift -= 4, ++i) {
+            end[i] = hex_digits[(shown >> shift) & 0xf];
+        }
+        buf.append(end, end + 8);
+    }
+    if (shown < size) {
+        fmt::format_to(std::back_inserter(buf), "{}... (+{} bytes)", layout == hex_layout::compact ? "" : "\n",
+                       size - shown);
+    }
+}
+
+// 日志参数：只保存指针和长度，异步路径在生产者打包参数时就转成文本
+struct hex_bytes {
+    const void* data;
+    size_t size;
+    hex_layout layout;
+    size_t max_bytes;
+};
+
+inline hex_bytes hex(const void* data, size_t size, size_t max_bytes = 4096) {
+    return hex_bytes{data, size, hex_layout::compact, max_bytes};
+}
+
+inline hex_bytes hexdump(const void* data, size_t size, size_t max_bytes = 4096) {
+    return hex_bytes{data, size, hex_layout::canonical, max_bytes};
+}
+
+namespace fmt {
+template <>
+struct formatter<hex_bytes> {
+    template <typename ParseContext>
+    FMT_CONSTEXPR auto parse(ParseContext& ctx) -> decltype(ctx.begin()) {
+        return ctx.begin();
+    }
+
+    template <typename FormatContext>
+    auto format(const hex_bytes& arg, FormatContext& ctx) const -> decltype(ctx.out()) {
+        memory_buffer buf;
+        hex_to(buf, arg.data, arg.size, arg.layout, arg.max_bytes);
+        return std::copy(buf.begin(), buf.end(), ctx.out());
+    }
+};
+}
+
+#endif
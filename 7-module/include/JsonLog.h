@@ -0,0 +1,166 @@
+#ifndef JSON_LOG_H
+#define JSON_LOG_H
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <mutex>
+#include <string>
+#include <fmt/format.h>
+#include "Escape.h"
+#include "LogFields.h"
+#include "Sinks.h"
+
+// 把一个 fmt 参数写成 JSON 值：整数走 format_int，浮点走 fmt 的最短表示，其余按字符串转义
+class json_value_writer {
+public:
+    json_value_writer(fmt::memory_buffer& buf, const fmt::format_args::format_arg& arg) : buf_(buf), arg_(arg) {}
+
+    void operator()(int v) { append(fmt::format_int(v)); }
+    void operator()(unsigned v) { append(fmt::format_int(v)); }
+    void operator()(long long v) { append(fmt::format_int(v)); }
+    void operator()(unsigned long long v) { append(fmt::format_int(v)); }
+    void operator()(bool v) { buf_.append(fmt::string_view(v ? "true" : "false")); }
+    void operator()(float v) { number(v); }
+    void operator()(double v) { number(v); }
+    void operator()(long double v) { number(v); }
+
+    void operator()(char v) { string(fmt::string_view(&v, 1)); }
+    void operator()(const char* v) { string(v ? v : ""); }
+    void operator()(fmt::string_view v) { string(v); }
+
+    // 指针、自定义类型等按 "{}" 格式化后作为字符串
+    template <typename T>
+    void operator()(const T&) {
+        fmt::memory_buffer tmp;
+        fmt::vformat_to(std::back_inserter(tmp), "{}", fmt::format_args(&arg_, 1));
+        string(fmt::string_view(tmp.data(), tmp.size()));
+    }
+
+private:
+    void append(const fmt::format_int& v) {
+        buf_.append(v.data(), v.data() + v.size());
+    }
+
+    // JSON 没有 NaN/Inf，写成 null
+    template <typename T>
+    void number(T v) {
+        if (std::isfinite(v)) {
+            fmt::format_to(std::back_inserter(buf_), "{}", v);
+        } else {
+            buf_.append(fmt::string_view("null"));
+        }
+    }
+
+    void string(fmt::string_view v) {
+        buf_.push_back('"');
+        json_escape(buf_, v);
+        buf_.push_back('"');
+    }
+
+    fmt::memory_buffer& buf_;
+    const fmt::format_args::format_arg& arg_;
+};
+
+inline void write_json_value(fmt::memory_buffer& buf, fmt::format_args::format_arg arg) {
+#ifdef FMT_BASE_H_
+    arg.visit(json_value_writer(buf, arg));
+#else
+    fmt::visit_format_arg(json_value_writer(buf, arg), arg);
+#endif
+}
+
+// JSON 行格式：{"ts":"2026-10-16T08:00:00.123456Z","level":"INFO","logger":"app","thread":"123:main","msg":"...","k":v}
+// 未命名的 logger 不写 "logger"
+// 直接写入输出缓冲，不构造中间 DOM；秒级时间前缀按秒缓存
+class json_formatter {
+public:
+    json_formatter() : cached_second_(-1) {}
+
+    void format(const packed_record& rec, fmt::memory_buffer& buf) {
+        buf.append(fmt::string_view("{\"ts\":\""));
+        int64_t second = rec.time_ns / 1000000000;
+        if (second != cached_second_) {
+            std::time_t t = static_cast<std::time_t>(second);
+            std::tm tm;
+            gmtime_r(&t, &tm);
+            cached_prefix_size_ = std::strftime(cached_prefix_, sizeof(cached_prefix_), "%Y-%m-%dT%H:%M:%S.", &tm);
+            cached_second_ = second;
+        }
+        buf.append(cached_prefix_, cached_prefix_ + cached_prefix_size_);
+        fmt::format_to(std::back_inserter(buf), "{:06}Z\",\"level\":\"", (rec.time_ns % 1000000000) / 1000);
+        json_escape(buf, rec.level_name);
+        if (rec.logger_name.size() != 0) {
+            buf.append(fmt::string_view("\",\"logger\":\""));
+            json_escape(buf, rec.logger_name);
+        }
+        buf.append(fmt::string_view("\",\"thread\":\""));
+        json_escape(buf, rec.thread_label);
+        buf.append(fmt::string_view("\",\"msg\":\""));
+        msg_buf_.clear();
+        fmt::vformat_to(std::back_inserter(msg_buf_), rec.format, rec.format_args);
+        json_escape(buf, fmt::string_view(msg_buf_.data(), msg_buf_.size()));
+        buf.push_back('"');
+        for (size_t i = 0; i < rec.fields.count; ++i) {
+            buf.append(fmt::string_view(",\""));
+            json_escape(buf, rec.fields.keys[i]);
+            buf.append(fmt::string_view("\":"));
+            write_json_value(buf, rec.fields.values.get(static_cast<int>(i)));
+        }
+        buf.append(fmt::string_view("}\n"));
+    }
+
+private:
+    int64_t cached_second_;
+    char cached_prefix_[32];
+    size_t cached_prefix_size_;
+    fmt::memory_buffer msg_buf_;
+};
+
+class json_file_sink : public base_sink {
+public:
+    json_file_sink(const std::string& filename) : filename_(filename) {
+        file_helper_.open(filename, false);
+    }
+
+    bool structured() const override { return true; }
+
+    // 非结构化文本整行作为 msg 输出
+    void log(const std::string& msg) override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        buf_.clear();
+        buf_.append(fmt::string_view("{\"msg\":\""));
+        json_escape(buf_, msg);
+        buf_.append(fmt::string_view("\"}\n"));
+        write_line();
+    }
+
+    void log_packed(const packed_record& rec) override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        buf_.clear();
+        formatter_.format(rec, buf_);
+        write_line();
+    }
+
+    void flush() override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        file_helper_.flush();
+    }
+
+private:
+    // 转义不改变 0x80 以上的字节，UTF-8 修复放在整行拼好之后
+    void write_line() {
+        fmt::string_view line = checked_utf8(fmt::string_view(buf_.data(), buf_.size()));
+        file_helper_.write(line.data(), line.size());
+    }
+
+    std::string filename_;
+    file_helper file_helper_;
+    json_formatter formatter_;
+    fmt::memory_buffer buf_;
+
+    std::mutex mutex_;
+};
+
+#endif
@@ -0,0 +1,51 @@
+#ifndef LAZY_ARG_H
+#define LAZY_ARG_H
+
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include <fmt/format.h>
+
+// 延迟求值的日志参数：
+//   logger->log(Logger::DEBUG, "请求内容：{}", lazy([&] { return dump(request); }));
+// 只有级别和 sink 过滤都通过、真正格式化或打包这个参数时才调用 f。
+// 异步路径在生产者线程打包时求值（f 通常按引用捕获调用方的局部变量），
+// 结果按值缓存，同一条记录写多个 sink 时 f 只调用一次。
+// LOG_* 宏在级别关闭时本来就不求值参数，不需要 lazy；
+// 宏参数里也不能直接写 lambda（C++11 中 lambda 不能出现在签名推导的 decltype 里）。
+template <typename F>
+class lazy_arg {
+public:
+    typedef typename std::decay<decltype(std::declval<F&>()())>::type value_type;
+
+    explicit lazy_arg(F f) : f_(std::move(f)) {}
+
+    const value_type& get() const {
+        if (!value_) {
+            value_.reset(new value_type(f_()));
+        }
+        return *value_;
+    }
+
+private:
+    mutable F f_;
+    mutable std::unique_ptr<value_type> value_;
+};
+
+template <typename F>
+inline lazy_arg<F> lazy(F f) {
+    return lazy_arg<F>(std::move(f));
+}
+
+namespace fmt {
+// 格式说明符原样交给结果类型的 formatter
+template <typename F>
+struct formatter<lazy_arg<F>> : formatter<typename lazy_arg<F>::value_type> {
+    template <typename FormatContext>
+    auto format(const lazy_arg<F>& arg, FormatContext& ctx) const -> decltype(ctx.out()) {
+        return formatter<typename lazy_arg<F>::value_type>::format(arg.get(), ctx);
+    }
+};
+}
+
+#endif
@@ -0,0 +1,44 @@
+#ifndef LEVEL_NAMES_H
+#define LEVEL_NAMES_H
+
+#include <cstddef>
+#include <fmt/core.h>
+
+// 级别名称的几种写法，日志头里按字节整段拷贝，不再经过 "{}" 格式化
+enum class level_style {
+    full,        // DEBUG / INFO / WARNING / ERROR
+    abbreviated, // D / I / W / E
+    padded,      // 补齐到 7 个字符，各行的消息对齐
+    colored      // 带 ANSI 颜色的完整名称，用于终端
+};
+
+struct level_text {
+    const char* data;
+    size_t size;
+};
+
+template <size_t N>
+constexpr level_text make_level_text(const char (&str)[N]) {
+    return level_text{str, N - 1};
+}
+
+static const size_t level_count = 4;
+
+// 下标依次为 level_style 和级别（与 Logger::LogLevel 的取值一致）
+static constexpr level_text level_names[4][level_count] = {
+    {make_level_text("DEBUG"), make_level_text("INFO"), make_level_text("WARNING"), make_level_text("ERROR")},
+    {make_level_text("D"), make_level_text("I"), make_level_text("W"), make_level_text("E")},
+    {make_level_text("DEBUG  "), make_level_text("INFO   "), make_level_text("WARNING"), make_level_text("ERROR  ")},
+    {make_level_text("\033[36mDEBUG\033[0m"), make_level_text("\033[32mINFO\033[0m"),
+     make_level_text("\033[33mWARNING\033[0m"), make_level_text("\033[31mERROR\033[0m")},
+};
+
+inline fmt::string_view level_name(int level, level_style style = level_style::full) {
+    if (level < 0 || static_cast<size_t>(level) >= level_count) {
+        return "UNKNOWN";
+    }
+    const level_text& text = level_names[static_cast<int>(style)][level];
+    return fmt::string_view(text.data, text.size);
+}
+
+#endif
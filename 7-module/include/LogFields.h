@@ -0,0 +1,90 @@
+#ifndef LOG_FIELDS_H
+#define LOG_FIELDS_H
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+#include <fmt/format.h>
+#include "ArgPack.h"
+
+// 结构化日志的键值字段：
+//   logger->log(Logger::INFO, log_fields(kv("user", name), kv("ms", 3.5)), "登录成功");
+// 值与格式化参数一样通过 fmt 类型擦除，只引用调用方的对象，整条语句结束前有效。
+template <typename T>
+struct log_field {
+    const char* key;
+    const T& value;
+};
+
+template <typename T>
+inline log_field<T> kv(const char* key, const T& value) {
+    return log_field<T>{key, value};
+}
+
+// 字段的类型擦除视图，count 为 0 表示没有字段
+struct field_view {
+    field_view() : keys(nullptr), count(0) {}
+    field_view(const fmt::string_view* keys, fmt::format_args values, size_t count)
+        : keys(keys), values(values), count(count) {}
+
+    const fmt::string_view* keys;
+    fmt::format_args values;
+    size_t count;
+};
+
+template <typename... T>
+class field_pack {
+public:
+    field_pack(const log_field<T>&... fields)
+        : keys_{fmt::string_view(fields.key)...}, values_(fmt::make_format_args(fields.value...)) {}
+
+    field_view view() const {
+        return field_view(keys_, values_, sizeof...(T));
+    }
+
+private:
+    fmt::string_view keys_[sizeof...(T) + 1];
+    decltype(fmt::make_format_args(std::declval<const T&>()...)) values_;
+};
+
+template <typename... T>
+inline field_pack<T...> log_fields(const log_field<T>&... fields) {
+    return field_pack<T...>(fields...);
+}
+
+// 打包格式：每个字段 = ArgPack 字符串键 + ArgPack 单个参数
+template <typename Buffer>
+inline void pack_fields(Buffer& buf, const field_view& fields) {
+    for (size_t i = 0; i < fields.count; ++i) {
+        pack_string(buf, fields.keys[i]);
+        pack_arg(buf, fields.values, static_cast<int>(i));
+    }
+}
+
+// 解包 [p, end) 中的 count 个字段，键写入 keys，值按顺序加入 store，均引用打包数据本身。
+// 每个字段至少占 5 字节（键长度 + 类型标签），count 与剩余字节不符时直接拒绝
+inline void unpack_fields(const char*& p, const char* end, size_t count, std::vector<fmt::string_view>& keys,
+                          fmt::dynamic_format_arg_store<fmt::format_context>& store, bool allow_static = true) {
+    if (count > static_cast<size_t>(end - p) / (sizeof(uint32_t) + sizeof(packed_type))) {
+        throw std::runtime_error("字段数与打包数据长度不符");
+    }
+    for (size_t i = 0; i < count; ++i) {
+        keys.push_back(unpack_string(p, end));
+        unpack_arg(p, end, store, allow_static);
+    }
+}
+
+// 文本行中字段追加在消息之后：" key=value key2=value2"
+template <typename Buffer>
+inline void format_fields_text(Buffer& buf, const field_view& fields) {
+    for (size_t i = 0; i < fields.count; ++i) {
+        buf.push_back(' ');
+        buf.append(fields.keys[i].data(), fields.keys[i].data() + fields.keys[i].size());
+        buf.push_back('=');
+        auto arg = fields.values.get(static_cast<int>(i));
+        fmt::vformat_to(std::back_inserter(buf), "{}", fmt::format_args(&arg, 1));
+    }
+}
+
+#endif
@@ -0,0 +1,791 @@
+#ifndef LOGGER_H
+#define LOGGER_H
+
+#include <atomic>
+#include <climits>
+#include <condition_variable>
+#include <cstring>
+#include <ctime>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include <fmt/core.h>
+#include "ThreadPool.h"
+#include "RecordQueue.h"
+#include "ArgPack.h"
+#include "Sinks.h"
+#include "TscClock.h"
+#include "ThreadInfo.h"
+#include "LogFields.h"
+#include "LazyArg.h"
+#include "BoundedRange.h"
+#include "HexDump.h"
+#include "LevelNames.h"
+
+// 异步记录内联缓冲的大小，打包后不超过它的记录不做堆分配
+#ifndef LOGGER_RECORD_INLINE_SIZE
+#define LOGGER_RECORD_INLINE_SIZE 256
+#endif
+
+class Logger {
+public:
+	enum LogLevel {
+		DEBUG,
+		INFO,
+		WARNING,
+		ERROR
+	};
+    // 调用点元数据：由 LOG_* 宏生成的静态对象，常量初始化，
+    // 热路径上只传递指针，首次调用时注册并分配 id
+    struct call_site {
+        constexpr call_site(LogLevel level, const char* format, const char* file, int line, const char* signature)
+            : level(level), format(format), file(file), line(line), signature(signature), id_(0) {}
+
+        uint32_t id() const {
+            uint32_t id = id_.load(std::memory_order_acquire);
+            return id != 0 ? id : register_site(*this);
+        }
+
+        // 按 id 查找已注册的调用点，id 从 1 开始
+        static const call_site* find(uint32_t id) {
+            std::lock_guard<std::mutex> lock(sites_mutex());
+            return id != 0 && id <= sites().size() ? sites()[id - 1] : nullptr;
+        }
+
+        const LogLevel level;
+        const char* const format;
+        const char* const file;
+        const int line;
+        const char* const signature;
+
+    private:
+        static uint32_t register_site(const call_site& site) {
+            std::lock_guard<std::mutex> lock(sites_mutex());
+            uint32_t id = site.id_.load(std::memory_order_relaxed);
+            if (id == 0) {
+                sites().push_back(&site);
+                id = static_cast<uint32_t>(sites().size());
+                site.id_.store(id, std::memory_order_release);
+            }
+            return id;
+        }
+
+        // 和驻留表一样故意泄漏，静态析构阶段仍在处理记录的工作线程可以继续查表
+        static std::vector<const call_site*>& sites() {
+            static std::vector<const call_site*>* sites = new std::vector<const call_site*>;
+            return *sites;
+        }
+
+        static std::mutex& sites_mutex() {
+            static std::mutex* mutex = new std::mutex;
+            return *mutex;
+        }
+
+        mutable std::atomic<uint32_t> id_;
+    };
+
+    explicit Logger(const std::string& name = std::string())
+        : name_(intern_name(name)), level_style_(level_style::full), cached_second_(-1), cached_date_size_(0) {
+        rebuild_headers();
+    }
+
+    virtual ~Logger() {
+    }
+
+    // 要求同步写入的 sink 不能加到异步 logger 上
+    void add_sink(std::shared_ptr<base_sink> sink) {
+        if (sink->synchronous() && asynchronous()) {
+            throw std::runtime_error("该 sink 只能用于同步 Logger，不能加到 AsyncLogger 上");
+        }
+        std::lock_guard<std::mutex> lock(sinks_mutex_);
+        sinks_.push_back(sink);
+    }
+
+    // 选择时间戳来源，不支持 TSC 时自动退回 CLOCK_MONOTONIC_RAW
+    void set_clock_source(clock_source source) {
+        clock_.store(resolve_clock_source(source));
+    }
+
+    // 名称非空时出现在文本行的级别之前："[time] [name] [LEVEL] [thread] msg"
+    void set_name(const std::string& name) {
+        std::lock_guard<std::mutex> lock(sinks_mutex_);
+        name_ = intern_name(name);
+        rebuild_headers();
+    }
+
+    std::string name() const {
+        std::lock_guard<std::mutex> lock(sinks_mutex_);
+        return *name_;
+    }
+
+    // 只影响文本行，JSON 和二进制日志始终使用完整的级别名称
+    void set_level_style(level_style style) {
+        std::lock_guard<std::mutex> lock(sinks_mutex_);
+        level_style_ = style;
+        rebuild_headers();
+    }
+
+    clock_source get_clock_source() const {
+        return clock_.load(std::memory_order_relaxed);
+    }
+
+    // 级别不够时立即返回，不采集时间、不打包参数；
+    // 开销大的参数用 lazy(...) 包装，或者使用 LOG_* 宏，关闭时连参数表达式也不求值
+    template <typename... Args>
+    void log(LogLevel level, fmt::string_view format, const Args&... args) {
+        if (!should_log(level)) {
+            return;
+        }
+        auto store = fmt::make_format_args(args...);
+        sink_it(log_msg(nullptr, level, format, store, log_stamp(get_clock_source()), field_view(),
+                        static_arg_mask<Args...>::value));
+    }
+
+    // 宏前端入口：格式串和级别来自静态调用点，无需传递或拷贝
+    template <typename... Args>
+    void log(const call_site& site, const Args&... args) {
+        if (!should_log(site.level)) {
+            return;
+        }
+        site.id();
+        auto store = fmt::make_format_args(args...);
+        sink_it(log_msg(&site, site.level, site.format, store, log_stamp(get_clock_source()), field_view(),
+                        static_arg_mask<Args...>::value));
+    }
+
+    // 带键值字段的结构化日志，字段由 log_fields(kv(...), ...) 构造
+    template <typename... Fields, typename... Args>
+    void log(LogLevel level, const field_pack<Fields...>& fields, fmt::string_view format, const Args&... args) {
+        if (!should_log(level)) {
+            return;
+        }
+        auto store = fmt::make_format_args(args...);
+        sink_it(log_msg(nullptr, level, format, store, log_stamp(get_clock_source()), fields.view(),
+                        static_arg_mask<Args...>::value));
+    }
+
+    template <typename... Fields, typename... Args>
+    void log(const call_site& site, const field_pack<Fields...>& fields, const Args&... args) {
+        if (!should_log(site.level)) {
+            return;
+        }
+        site.id();
+        auto store = fmt::make_format_args(args...);
+        sink_it(log_msg(&site, site.level, site.format, store, log_stamp(get_clock_source()), fields.view(),
+                        static_arg_mask<Args...>::value));
+    }
+    
+    // 记录一段二进制数据，最多转换 max_bytes 字节：
+    // compact 写成 "title (N 字节) 0a1b..."，canonical 在标题后换行输出 hexdump -C 格式
+    void log_hex(LogLevel level, fmt::string_view title, const void* data, size_t size,
+                 hex_layout layout = hex_layout::compact, size_t max_bytes = 4096) {
+        if (!should_log(level)) {
+            return;
+        }
+        hex_bytes bytes = {data, size, layout, max_bytes};
+        log(level, layout == hex_layout::canonical ? "{} ({} 字节)\n{}" : "{} ({} 字节) {}", title, size, bytes);
+    }
+
+    void set_level(LogLevel log_level) {
+        level_.store(log_level);
+    }
+
+    LogLevel level() const {
+        return level_.load(std::memory_order_relaxed);
+    }
+
+    bool should_log(LogLevel level) const {
+        return level >= level_.load(std::memory_order_relaxed);
+    }
+
+    // 级别不低于 level 的记录写入后立即 flush 它写到的 sink，默认不按级别 flush
+    void flush_on(LogLevel level) {
+        flush_level_.store(level, std::memory_order_relaxed);
+    }
+
+    // flush 所有 sink。异步 logger 只写出工作线程已经处理完的记录
+    void flush() {
+        std::lock_guard<std::mutex> lock(sinks_mutex_);
+        for (auto& sink : sinks_) {
+            sink->flush();
+        }
+    }
+	
+protected:
+    std::vector<std::shared_ptr<base_sink>> sinks_;
+    mutable std::mutex sinks_mutex_;
+    std::atomic<LogLevel> level_{LogLevel::INFO};
+    std::atomic<clock_source> clock_{clock_source::realtime};
+    std::atomic<int> flush_level_{INT_MAX};
+
+    // 以下文本行头部缓存均受 sinks_mutex_ 保护
+    const std::string* name_;            // 驻留字符串，异步记录处理时改名也不会悬空
+    level_style level_style_;
+    std::string headers_[level_count];   // 每个级别预先拼好的 "] [name] [LEVEL] "
+    mutable int64_t cached_second_;
+    mutable char cached_date_[32];       // "[" + ctime 去掉换行，按秒缓存
+    mutable size_t cached_date_size_;
+
+    // 生产者在调用时采集的时间与线程信息，异步路径原样随记录入队
+    struct log_stamp {
+        explicit log_stamp(clock_source clock) : clock(clock), ticks(capture_ticks(clock)) {
+            const thread_info& thread = this_thread_info();
+            tid = thread.tid;
+            thread_field = thread.field.load(std::memory_order_relaxed);
+        }
+
+        clock_source clock;       // 原始刻度在写入 sink 前才换算为墙上时间
+        uint64_t ticks;
+        uint32_t tid;
+        const std::string* thread_field; // 驻留字符串，预先拼好的 "[tid] " 或 "[tid:name] "
+    };
+
+    // args 只是指向参数 store 的视图，store 必须比 log_msg 活得久：先写 auto store = fmt::make_format_args(...)
+    // 再传入。直接传临时的 store（log_msg msg{..., fmt::make_format_args(args...)}）会在语句结束后悬空，
+    // 这种写法由下面删除的重载在编译期拒绝
+    struct log_msg {
+        log_msg(const call_site* site, LogLevel level, fmt::string_view format, fmt::format_args args,
+                const log_stamp& stamp, field_view fields = field_view(), uint64_t static_args = 0)
+            : site(site), level(level), format(format), args(args), stamp(stamp), fields(fields),
+              static_args(static_args), has_packed(false) {}
+
+        template <typename Store, typename = typename std::enable_if<
+                                      !std::is_reference<Store>::value &&
+                                      !std::is_same<typename std::decay<Store>::type, fmt::format_args>::value>::type>
+        log_msg(const call_site* site, LogLevel level, fmt::string_view format, Store&& temporary_store,
+                const log_stamp& stamp, field_view fields = field_view(), uint64_t static_args = 0) = delete;
+
+        const call_site* site; // 非宏调用时为 nullptr
+        LogLevel level;
+        fmt::string_view format;
+        fmt::format_args args;
+        log_stamp stamp;
+        field_view fields;
+        uint64_t static_args;  // static_str 参数的位图，异步路径只打包它们的指针
+        bool has_packed;       // 异步路径已有打包好的参数和字段，否则需要时再打包
+        fmt::string_view packed_args;
+        fmt::string_view packed_fields;
+    };
+
+    // 日志调用返回时记录是否还没交给 sink
+    virtual bool asynchronous() const { return false; }
+
+    // 参数已经类型擦除，子类可以改写为异步投递
+    virtual void sink_it(const log_msg& msg) {
+        write_to_sinks(msg);
+    }
+
+    // 每个线程一份的格式化缓冲，反复使用，稳定后不再分配。
+    // 格式化参数时可能重入（例如 lazy 参数里又写日志），重入的调用改用临时缓冲
+    struct format_scratch {
+        format_scratch() : in_use(false) {}
+
+        fmt::memory_buffer body; // 消息正文和文本字段，带换行
+        std::string entry;       // 拼上日志头后交给文本 sink 的整行
+        std::string packed;      // 交给二进制 sink 的打包参数和字段
+        bool in_use;
+    };
+
+    class scratch_lease {
+    public:
+        scratch_lease() : scratch_(&thread_scratch()) {
+            if (scratch_->in_use) {
+                nested_.reset(new format_scratch());
+                scratch_ = nested_.get();
+            }
+            scratch_->in_use = true;
+        }
+
+        ~scratch_lease() {
+            scratch_->in_use = false;
+        }
+
+        format_scratch& operator*() const { return *scratch_; }
+        format_scratch* operator->() const { return scratch_; }
+
+    private:
+        static format_scratch& thread_scratch() {
+            static thread_local format_scratch scratch;
+            return scratch;
+        }
+
+        format_scratch* scratch_;
+        std::unique_ptr<format_scratch> nested_;
+    };
+
+    const char* toString(LogLevel level) const {
+        return level_name(level).data();
+    }
+
+    std::string currentDateTime(std::time_t now = std::time(nullptr)) const {
+        char dt[32];
+        ctime_r(&now, dt);
+        return std::string(dt, std::strlen(dt) - 1); // 移除换行符
+    }
+
+    // 名称只增不删，返回的指针在进程内一直有效；表故意泄漏，静态析构阶段也不释放
+    static const std::string* intern_name(const std::string& name) {
+        static std::mutex* mutex = new std::mutex;
+        static std::unordered_set<std::string>* names = new std::unordered_set<std::string>;
+        std::lock_guard<std::mutex> lock(*mutex);
+        return &*names->insert(name).first;
+    }
+
+    // 名称或级别写法变化时才重建，写日志时整段拷贝
+    void rebuild_headers() {
+        for (size_t level = 0; level < level_count; ++level) {
+            std::string& header = headers_[level];
+            header = "] ";
+            if (!name_->empty()) {
+                header += "[" + *name_ + "] ";
+            }
+            fmt::string_view text = level_name(static_cast<int>(level), level_style_);
+            header += "[";
+            header.append(text.data(), text.size());
+            header += "] ";
+        }
+    }
+
+    // 日志头的三个片段："[" + 按秒缓存的时间、预先拼好的 "] [name] [LEVEL] "、线程字段。
+    // 需要持有 sinks_mutex_，片段在下一次调用前有效
+    void header_parts(const log_msg& msg, int64_t time_ns, fmt::string_view* parts) const {
+        int64_t second = time_ns / 1000000000;
+        if (second != cached_second_) {
+            std::time_t now = static_cast<std::time_t>(second);
+            cached_date_[0] = '[';
+            ctime_r(&now, cached_date_ + 1);
+            cached_date_size_ = std::strlen(cached_date_) - 1; // 移除换行符
+            cached_second_ = second;
+        }
+        parts[0] = fmt::string_view(cached_date_, cached_date_size_);
+        parts[1] = static_cast<size_t>(msg.level) < level_count ? fmt::string_view(headers_[msg.level])
+                                                                : fmt::string_view("] [UNKNOWN] ");
+        parts[2] = *msg.stamp.thread_field;
+    }
+
+    void append_header(std::string& out, const log_msg& msg, int64_t time_ns) const {
+        fmt::string_view parts[3];
+        header_parts(msg, time_ns, parts);
+        for (const auto& part : parts) {
+            out.append(part.data(), part.size());
+        }
+    }
+
+    // 正文不依赖 logger 状态，可以在锁外格式化
+    static void format_body(fmt::memory_buffer& buf, const log_msg& msg) {
+        buf.clear();
+        fmt::vformat_to(std::back_inserter(buf), msg.format, msg.args);
+        format_fields_text(buf, msg.fields);
+        buf.push_back('\n');
+    }
+
+    static void pack_record(std::string& buf, const log_msg& msg, fmt::string_view& args, fmt::string_view& fields) {
+        buf.clear();
+        pack_args(buf, msg.format, msg.args);
+        size_t args_size = buf.size();
+        pack_fields(buf, msg.fields);
+        args = fmt::string_view(buf.data(), args_size);
+        fields = fmt::string_view(buf.data() + args_size, buf.size() - args_size);
+    }
+
+    std::string format_entry(const log_msg& msg, int64_t time_ns) const {
+        fmt::memory_buffer body;
+        format_body(body, msg);
+        std::string entry;
+        append_header(entry, msg, time_ns);
+        entry.append(body.data(), body.size());
+        return entry;
+    }
+
+    packed_record make_packed(const log_msg& msg, int64_t time_ns, fmt::string_view args,
+                              fmt::string_view fields) const {
+        packed_record rec;
+        rec.site_id = msg.site ? msg.site->id() : 0;
+        rec.level = msg.level;
+        rec.level_name = level_name(msg.level);
+        rec.logger_name = *name_;
+        rec.format = msg.format;
+        rec.file = msg.site ? msg.site->file : nullptr;
+        rec.line = msg.site ? msg.site->line : 0;
+        rec.signature = msg.site ? msg.site->signature : nullptr;
+        rec.time_ns = time_ns;
+        rec.tid = msg.stamp.tid;
+        rec.thread_label = thread_label(msg.stamp.thread_field);
+        rec.format_args = msg.args;
+        rec.fields = msg.fields;
+        rec.args = args;
+        rec.packed_fields = fields;
+        return rec;
+    }
+
+    // 文本只格式化一次，参数只打包一次，且只在有对应类型、级别通过的 sink 时才做。
+    // 先在锁内看一眼需要哪些形式，正文格式化和参数打包放到锁外的线程本地缓冲里，
+    // sinks_mutex_ 只覆盖拼日志头和交给 sink 这一步，多个线程的格式化可以并行
+    void write_to_sinks(const log_msg& msg) {
+        if (!should_log(msg.level)) {
+            return;
+        }
+        bool any = false;
+        bool need_text = false;
+        bool need_binary = false;
+        {
+            std::lock_guard<std::mutex> lock(sinks_mutex_);
+            for (auto& sink : sinks_) {
+                if (sink->should_log(msg.level)) {
+                    any = true;
+                    need_text = need_text || !sink->structured();
+                    need_binary = need_binary || sink->binary();
+                }
+            }
+        }
+        if (!any) {
+            return;
+        }
+
+        int64_t time_ns = tick_converter::instance().to_realtime_ns(msg.stamp.clock, msg.stamp.ticks);
+        scratch_lease scratch;
+        fmt::string_view packed_args = msg.packed_args;
+        fmt::string_view packed_fields = msg.packed_fields;
+        bool has_packed = msg.has_packed;
+        if (need_text) {
+            format_body(scratch->body, msg);
+        }
+        if (need_binary && !has_packed) {
+            pack_record(scratch->packed, msg, packed_args, packed_fields);
+            has_packed = true;
+        }
+
+        // 两次加锁之间可能新增了 sink，缺的形式在锁内补上。
+        // 支持分片的 sink 直接拿到日志头和正文的片段，其余 sink 共用拼好的整行
+        // 写入后按级别或 sink 的写入量阈值 flush
+        std::lock_guard<std::mutex> lock(sinks_mutex_);
+        bool flush_level = msg.level >= flush_level_.load(std::memory_order_relaxed);
+        fmt::string_view parts[4];
+        size_t text_size = 0;
+        bool has_parts = false;
+        bool joined = false;
+        for (auto& sink : sinks_) {
+            if (!sink->should_log(msg.level)) {
+                continue;
+            }
+            if (sink->structured()) {
+                if (sink->binary() && !has_packed) {
+                    pack_record(scratch->packed, msg, packed_args, packed_fields);
+                    has_packed = true;
+                }
+                sink->log_packed(make_packed(msg, time_ns, packed_args, packed_fields));
+                if (sink->count_written(0) || flush_level) {
+                    sink->flush();
+                }
+                continue;
+            }
+            if (!has_parts) {
+                if (!need_text) {
+                    format_body(scratch->body, msg);
+                    need_text = true;
+                }
+                header_parts(msg, time_ns, parts);
+                parts[3] = fmt::string_view(scratch->body.data(), scratch->body.size());
+                for (const auto& part : parts) {
+                    text_size += part.size();
+                }
+                has_parts = true;
+            }
+            if (sink->timed()) {
+                sink->log_timed(parts, 4, time_ns);
+            } else if (sink->fragments()) {
+                sink->log_fragments(parts, 4);
+            } else {
+                if (!joined) {
+                    scratch->entry.clear();
+                    for (const auto& part : parts) {
+                        scratch->entry.append(part.data(), part.size());
+                    }
+                    joined = true;
+                }
+                sink->log(scratch->entry);
+            }
+            if (sink->count_written(text_size) || flush_level) {
+                sink->flush();
+            }
+        }
+    }
+};
+
+// 日志宏：每个调用点生成一个静态 call_site，参数签名在编译期推导。
+// 先检查级别再求值参数，关闭的级别只有一次原子读的开销。
+// 级别随 call_site 在第一次调用时固定下来，必须是编译期常量（运行时的级别用 logger->log(level, ...)），
+// integral_constant 让传入变量的写法编译失败
+#define LOGGER_CALL(logger, level, format, ...)                                              \
+    do {                                                                                     \
+        static const Logger::call_site log_site_(                                            \
+            std::integral_constant<Logger::LogLevel, level>::value, format, __FILE__,        \
+            __LINE__, decltype(make_arg_signature(__VA_ARGS__))::value);                     \
+        auto&& log_logger_ = (logger);                                                       \
+        if (log_logger_->should_log(level)) {                                                \
+            log_logger_->log(log_site_, ##__VA_ARGS__);                                      \
+        }                                                                                    \
+    } while (0)
+
+#define LOG_DEBUG(logger, ...) LOGGER_CALL(logger, Logger::DEBUG, __VA_ARGS__)
+#define LOG_INFO(logger, ...) LOGGER_CALL(logger, Logger::INFO, __VA_ARGS__)
+#define LOG_WARNING(logger, ...) LOGGER_CALL(logger, Logger::WARNING, __VA_ARGS__)
+#define LOG_ERROR(logger, ...) LOGGER_CALL(logger, Logger::ERROR, __VA_ARGS__)
+
+// 带键值字段的宏：LOG_KV_INFO(logger, log_fields(kv("user", name)), "登录成功 {}", id)
+#define LOGGER_KV_CALL(logger, level, fields, format, ...)                                   \
+    do {                                                                                     \
+        static const Logger::call_site log_site_(                                            \
+            std::integral_constant<Logger::LogLevel, level>::value, format, __FILE__,        \
+            __LINE__, decltype(make_arg_signature(__VA_ARGS__))::value);                     \
+        auto&& log_logger_ = (logger);                                                       \
+        if (log_logger_->should_log(level)) {                                                \
+            log_logger_->log(log_site_, fields, ##__VA_ARGS__);                              \
+        }                                                                                    \
+    } while (0)
+
+#define LOG_KV_DEBUG(logger, fields, ...) LOGGER_KV_CALL(logger, Logger::DEBUG, fields, __VA_ARGS__)
+#define LOG_KV_INFO(logger, fields, ...) LOGGER_KV_CALL(logger, Logger::INFO, fields, __VA_ARGS__)
+#define LOG_KV_WARNING(logger, fields, ...) LOGGER_KV_CALL(logger, Logger::WARNING, fields, __VA_ARGS__)
+#define LOG_KV_ERROR(logger, fields, ...) LOGGER_KV_CALL(logger, Logger::ERROR, fields, __VA_ARGS__)
+
+class AsyncLogger : public Logger {
+public:
+    // 异步记录的大小分布：按打包后字节数分桶，上界依次为 32/64/128/256/512/1024/4096 字节，最后一桶不设上界
+    struct record_stats {
+        static const size_t bucket_count = 8;
+        static size_t bucket_limit(size_t i) {
+            static const size_t limits[bucket_count - 1] = {32, 64, 128, 256, 512, 1024, 4096};
+            return i < bucket_count - 1 ? limits[i] : SIZE_MAX;
+        }
+
+        uint64_t total;
+        uint64_t bytes;    // 打包后的总字节数
+        uint64_t spilled;  // 超出内联缓冲、发生堆分配的记录数
+        uint64_t buckets[bucket_count];
+    };
+
+    AsyncLogger(size_t poolSize = 1, const std::string& name = std::string()) : Logger(name), queue_(1000) {
+        for (auto& bucket : size_buckets_) {
+            bucket.store(0, std::memory_order_relaxed);
+        }
+        for (size_t i = 0; i < poolSize; ++i) {
+            workers_.emplace_back([this] {
+                while (queue_.pop([this](async_msg& msg) { process_safely(msg); })) {
+                }
+            });
+        }
+    }
+
+    record_stats stats() const {
+        record_stats stats;
+        stats.total = 0;
+        for (size_t i = 0; i < record_stats::bucket_count; ++i) {
+            stats.buckets[i] = size_buckets_[i].load(std::memory_order_relaxed);
+            stats.total += stats.buckets[i];
+        }
+        stats.bytes = bytes_.load(std::memory_order_relaxed);
+        stats.spilled = spilled_.load(std::memory_order_relaxed);
+        return stats;
+    }
+
+    // 先处理完已入队的记录再停下工作线程，此后基类才析构 sink
+    ~AsyncLogger() {
+        shutdown();
+        queue_.close();
+        for (auto& worker : workers_) {
+            worker.join();
+        }
+    }
+
+    void shutdown() {
+    }
+
+protected:
+    bool asynchronous() const override { return true; }
+
+    // 生产者只把格式串和参数打包成二进制记录，格式化在工作线程完成。
+    // 宏调用点只记录指针，不再拷贝格式串
+    void sink_it(const log_msg& msg) override {
+        async_msg rec(msg.site, msg.level, msg.stamp, msg.fields.count);
+        if (!msg.site) {
+            pack_string(rec.payload, msg.format);
+        }
+        pack_fields(rec.payload, msg.fields);
+        pack_args(rec.payload, msg.format, msg.args, msg.static_args);
+        rec.has_static = msg.static_args != 0;
+        count_record(rec.payload.size());
+        queue_.push(std::move(rec));
+    }
+
+private:
+    // 只能移动：内联部分按字节拷贝，溢出到堆上的缓冲直接转移所有权，移入、移出队列都不会重新分配
+    struct async_msg {
+        async_msg(const call_site* site, LogLevel level, const log_stamp& stamp, size_t field_count)
+            : site(site), level(level), stamp(stamp), field_count(field_count), has_static(false) {}
+        async_msg(async_msg&&) = default;
+
+        const call_site* site;
+        LogLevel level;
+        log_stamp stamp;
+        size_t field_count;
+        bool has_static;      // 参数中有只保存了指针的静态字符串
+        fmt::basic_memory_buffer<char, LOGGER_RECORD_INLINE_SIZE> payload; // 格式串 + 打包后的字段 + 打包后的参数
+    };
+
+    void count_record(size_t size) {
+        size_t i = 0;
+        while (size > record_stats::bucket_limit(i)) {
+            ++i;
+        }
+        size_buckets_[i].fetch_add(1, std::memory_order_relaxed);
+        bytes_.fetch_add(size, std::memory_order_relaxed);
+        if (size > LOGGER_RECORD_INLINE_SIZE) {
+            spilled_.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    // 处理抛出异常（如格式串与参数不符）时丢弃这条记录，工作线程继续处理后面的记录
+    void process_safely(const async_msg& msg) {
+        try {
+            process(msg);
+        } catch (const std::exception&) {
+        }
+    }
+
+    void process(const async_msg& msg) {
+        const char* p = msg.payload.data();
+        const char* end = p + msg.payload.size();
+        fmt::string_view format = msg.site ? fmt::string_view(msg.site->format) : unpack_string(p, end);
+        const char* fields_begin = p;
+        std::vector<fmt::string_view> keys;
+        fmt::dynamic_format_arg_store<fmt::format_context> values;
+        unpack_fields(p, end, msg.field_count, keys, values);
+        fmt::string_view packed_fields(fields_begin, p - fields_begin);
+        fmt::dynamic_format_arg_store<fmt::format_context> store;
+        const char* args_begin = p;
+        unpack_args(p, end, store);
+
+        log_msg entry(msg.site, msg.level, format, store, msg.stamp, field_view(keys.data(), values, msg.field_count));
+        // 含静态字符串指针的参数不能交给二进制 sink，需要时按内容重新打包
+        entry.has_packed = !msg.has_static;
+        entry.packed_args = fmt::string_view(args_begin, end - args_begin);
+        entry.packed_fields = packed_fields;
+
+        write_to_sinks(entry);
+    }
+
+    std::atomic<uint64_t> size_buckets_[record_stats::bucket_count];
+    std::atomic<uint64_t> bytes_{0};
+    std::atomic<uint64_t> spilled_{0};
+    record_queue<async_msg> queue_;
+    std::vector<std::thread> workers_;
+};
+
+class Registry {
+public:
+    static Registry& getInstance() {
+        static Registry instance;
+        return instance;
+    }
+
+    void registerLogger(const std::string& name, std::shared_ptr<Logger> logger) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        loggers_[name] = logger;
+    }
+
+    std::shared_ptr<Logger> getLogger(const std::string& name) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = loggers_.find(name);
+        if (it != loggers_.end()) {
+            return it->second;
+        }
+        return nullptr;
+    }
+
+    // flush 所有已注册的 logger，在锁外逐个进行，flush 期间可以继续注册和查找
+    void flush_all() {
+        std::vector<std::shared_ptr<Logger>> loggers;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            for (auto& entry : loggers_) {
+                loggers.push_back(entry.second);
+            }
+        }
+        for (auto& logger : loggers) {
+            logger->flush();
+        }
+    }
+
+    // 所有 logger 共用一个定时线程，每隔 interval 调用一次 flush_all；
+    // 再次调用改为新的间隔，interval 为 0 时停止。flush 抛出的异常不中断定时线程。
+    // 多个线程同时调用时停止和重启整体串行；不能在定时线程里（如某个 sink 的 flush 中）调用，否则要 join 自己
+    void flush_every(std::chrono::milliseconds interval) {
+        if (in_flusher_thread()) {
+            throw std::runtime_error("不能在定时 flush 线程内调用 flush_every");
+        }
+        std::lock_guard<std::mutex> control(flusher_control_mutex_);
+        stop_flusher();
+        if (interval.count() <= 0) {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(flusher_mutex_);
+        flusher_stop_ = false;
+        flusher_ = std::thread([this, interval] {
+            in_flusher_thread() = true;
+            std::unique_lock<std::mutex> lock(flusher_mutex_);
+            while (!flusher_cv_.wait_for(lock, interval, [this] { return flusher_stop_; })) {
+                lock.unlock();
+                try {
+                    flush_all();
+                } catch (const std::exception&) {
+                }
+                lock.lock();
+            }
+        });
+    }
+
+private:
+    Registry() : flusher_stop_(false) {}
+    ~Registry() {
+        std::lock_guard<std::mutex> control(flusher_control_mutex_);
+        stop_flusher();
+    }
+    Registry(const Registry&) = delete;
+    Registry& operator=(const Registry&) = delete;
+
+    static bool& in_flusher_thread() {
+        static thread_local bool value = false;
+        return value;
+    }
+
+    // 需要持有 flusher_control_mutex_
+    void stop_flusher() {
+        {
+            std::lock_guard<std::mutex> lock(flusher_mutex_);
+            flusher_stop_ = true;
+        }
+        flusher_cv_.notify_all();
+        if (flusher_.joinable()) {
+            flusher_.join();
+        }
+    }
+
+    std::unordered_map<std::string, std::shared_ptr<Logger>> loggers_;
+    std::mutex mutex_;
+
+    std::thread flusher_;
+    std::mutex flusher_control_mutex_;  // 串行化 flush_every 的停止和重启
+    std::mutex flusher_mutex_;
+    std::condition_variable flusher_cv_;
+    bool flusher_stop_;
+};
+
+#endif
@@ -0,0 +1,235 @@
+#ifndef MMAP_SINK_H
+#define MMAP_SINK_H
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <fmt/core.h>
+#include "Sinks.h"
+
+// flush 和窗口换出时对已写区域做的 msync
+enum class msync_policy {
+    none,   // 交给内核回写，数据写入映射后就已在页缓存里
+    async,  // msync(MS_ASYNC)，发起回写但不等待
+    sync    // msync(MS_SYNC)，落盘后才返回
+};
+
+// 基于内存映射的文件写入，与 file_helper 的接口相同：
+// 文件按 window_size 分块 fallocate，映射当前块，写入只是 memcpy，不再每次系统调用；
+// 当前块写满时换到下一块。关闭时按实际写入的长度 ftruncate，去掉预分配的尾部。
+// 进程崩溃来不及关闭时，文件末尾会留下预分配的零字节
+class mmap_file_helper {
+public:
+    static const size_t default_window_size = 16 * 1024 * 1024;
+
+    explicit mmap_file_helper(size_t window_size = default_window_size, msync_policy policy = msync_policy::none)
+        : fd_(-1), window_size_(round_to_page(window_size)), policy_(policy), map_(nullptr), map_offset_(0),
+          size_(0), synced_(0) {}
+
+    mmap_file_helper(const mmap_file_helper&) = delete;
+    mmap_file_helper& operator=(const mmap_file_helper&) = delete;
+
+    ~mmap_file_helper() {
+        try {
+            close();
+        } catch (const std::exception&) {
+            // 析构时无处报告失败
+        }
+    }
+
+    void open(const std::string& filename, bool truncate = false) {
+        close();
+        int fd;
+        do {
+            fd = ::open(filename.c_str(), O_RDWR | O_CREAT | O_CLOEXEC | (truncate ? O_TRUNC : 0), 0644);
+        } while (fd < 0 && errno == EINTR);
+        if (fd < 0) {
+            throw std::runtime_error("无法打开文件：" + filename + "：" + std::strerror(errno));
+        }
+        struct stat st;
+        if (fstat(fd, &st) != 0) {
+            std::string reason = std::strerror(errno);
+            ::close(fd);
+            throw std::runtime_error("无法打开文件：" + filename + "：" + reason);
+        }
+        fd_ = fd;
+        size_ = static_cast<uint64_t>(st.st_size);
+        map_window(size_ / page_size() * page_size());
+    }
+
+    void write(const std::string& msg) {
+        write(msg.data(), msg.size());
+    }
+
+    void write(const char* data, size_t size) {
+        if (fd_ < 0) {
+            throw std::runtime_error("文件未打开");
+        }
+        while (size > 0) {
+            size_t space = static_cast<size_t>(map_offset_ + window_size_ - size_);
+            if (space == 0) {
+                map_window(map_offset_ + window_size_);
+                continue;
+            }
+            size_t n = size < space ? size : space;
+            std::memcpy(map_ + (size_ - map_offset_), data, n);
+            size_ += n;
+            data += n;
+            size -= n;
+        }
+    }
+
+    void write_fragments(const fmt::string_view* parts, size_t count) {
+        for (size_t i = 0; i < count; ++i) {
+            write(parts[i].data(), parts[i].size());
+        }
+    }
+
+    void flush() {
+        if (fd_ < 0) {
+            throw std::runtime_error("文件未打开");
+        }
+        sync_written();
+    }
+
+    void close() {
+        if (fd_ < 0) {
+            return;
+        }
+        int fd = fd_;
+        fd_ = -1;
+        bool ok = true;
+        std::string reason;
+        if (map_) {
+            ok = sync_range(synced_, size_, reason);
+            munmap(map_, window_size_);
+            map_ = nullptr;
+        }
+        if (ok && ftruncate(fd, static_cast<off_t>(size_)) != 0) {
+            ok = false;
+            reason = std::strerror(errno);
+        }
+        ::close(fd);
+        if (!ok) {
+            throw std::runtime_error("关闭映射文件失败：" + reason);
+        }
+    }
+
+private:
+    static size_t page_size() {
+        static const size_t size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+        return size;
+    }
+
+    static size_t round_to_page(size_t size) {
+        size_t page = page_size();
+        return size < page ? page : (size + page - 1) / page * page;
+    }
+
+    // 换出当前窗口（按策略 msync），预分配并映射从 offset 开始的下一块
+    void map_window(uint64_t offset) {
+        std::string reason;
+        if (map_) {
+            bool ok = sync_range(synced_, size_, reason);
+            munmap(map_, window_size_);
+            map_ = nullptr;
+            if (!ok) {
+                throw std::runtime_error("同步映射文件失败：" + reason);
+            }
+        }
+        int err = posix_fallocate(fd_, static_cast<off_t>(offset), static_cast<off_t>(window_size_));
+        if (err != 0) {
+            throw std::runtime_error(std::string("预分配文件空间失败：") + std::strerror(err));
+        }
+        void* map = mmap(nullptr, window_size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, static_cast<off_t>(offset));
+        if (map == MAP_FAILED) {
+            throw std::runtime_error(std::string("映射文件失败：") + std::strerror(errno));
+        }
+        // 共享映射的页第一次写入时各触发一次缺页，整块预先按可写建好页表（5.14 起支持，失败时忽略）
+#ifdef MADV_POPULATE_WRITE
+        madvise(map, window_size_, MADV_POPULATE_WRITE);
+#endif
+        map_ = static_cast<char*>(map);
+        map_offset_ = offset;
+        synced_ = size_;
+    }
+
+    void sync_written() {
+        std::string reason;
+        if (!sync_range(synced_, size_, reason)) {
+            throw std::runtime_error("同步映射文件失败：" + reason);
+        }
+    }
+
+    // msync 要求起点按页对齐，范围限定在当前窗口内
+    bool sync_range(uint64_t begin, uint64_t end, std::string& reason) {
+        if (policy_ == msync_policy::none || !map_ || end <= begin) {
+            synced_ = end;
+            return true;
+        }
+        uint64_t start = begin < map_offset_ ? map_offset_ : begin / page_size() * page_size();
+        int flags = policy_ == msync_policy::sync ? MS_SYNC : MS_ASYNC;
+        if (msync(map_ + (start - map_offset_), static_cast<size_t>(end - start), flags) != 0) {
+            reason = std::strerror(errno);
+            return false;
+        }
+        synced_ = end;
+        return true;
+    }
+
+    int fd_;
+    size_t window_size_;
+    msync_policy policy_;
+    char* map_;
+    uint64_t map_offset_;  // 当前窗口在文件中的起始位置，按页对齐
+    uint64_t size_;        // 实际写入的长度，即关闭时的文件大小
+    uint64_t synced_;      // 已按策略 msync 到的位置
+};
+
+// 文本文件 sink，写入路径上没有系统调用，适合最高频率的 logger
+class mmap_file_sink : public base_sink {
+public:
+    mmap_file_sink(const std::string& filename, size_t window_size = mmap_file_helper::default_window_size,
+                   msync_policy policy = msync_policy::none)
+        : filename_(filename), file_helper_(window_size, policy) {
+        file_helper_.open(filename, false);
+    }
+
+    void log(const std::string& msg) override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        fmt::string_view line = checked_utf8(msg);
+        file_helper_.write(line.data(), line.size());
+    }
+
+    bool fragments() const override { return true; }
+
+    void log_fragments(const fmt::string_view* parts, size_t count) override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        fmt::string_view line;
+        if (checked_utf8(parts, count, line)) {
+            file_helper_.write(line.data(), line.size());
+        } else {
+            file_helper_.write_fragments(parts, count);
+        }
+    }
+
+    void flush() override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        file_helper_.flush();
+    }
+
+private:
+    std::string filename_;
+    mmap_file_helper file_helper_;
+
+    std::mutex mutex_;
+};
+
+#endif
@@ -0,0 +1,98 @@
+#ifndef RECORD_QUEUE_H
+#define RECORD_QUEUE_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+// 有界的记录队列：槽位在构造时一次分配，push 把记录移动进槽位，pop 再移动出来交给回调。
+// 和 ThreadPool::enqueue 不同，入队不经过 std::bind、packaged_task、future 和 std::function，
+// 只要 T 的移动不分配，入队就不分配。队列满时生产者阻塞（与 async_overflow_policy::block 相同）。
+// T 只需要能移动构造，不要求默认构造
+template <typename T>
+class record_queue {
+public:
+    explicit record_queue(size_t capacity)
+        : slots_(new slot[capacity]), capacity_(capacity), head_(0), size_(0), closed_(false) {
+        if (capacity == 0) {
+            throw std::runtime_error("记录队列的容量必须大于 0");
+        }
+    }
+
+    record_queue(const record_queue&) = delete;
+    record_queue& operator=(const record_queue&) = delete;
+
+    ~record_queue() {
+        for (; size_ > 0; --size_) {
+            at(head_)->~T();
+            head_ = (head_ + 1) % capacity_;
+        }
+    }
+
+    // 队列满时阻塞直到有空位；队列已关闭时抛出
+    void push(T&& value) {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            not_full_.wait(lock, [this] { return closed_ || size_ < capacity_; });
+            if (closed_) {
+                throw std::runtime_error("记录队列已关闭");
+            }
+            new (at((head_ + size_) % capacity_)) T(std::move(value));
+            ++size_;
+        }
+        not_empty_.notify_one();
+    }
+
+    // 取出最早的一条，在锁外交给 f(T&)；队列关闭且已取空时返回 false
+    template <typename F>
+    bool pop(F f) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        not_empty_.wait(lock, [this] { return closed_ || size_ > 0; });
+        if (size_ == 0) {
+            return false;
+        }
+        T* front = at(head_);
+        T value(std::move(*front));
+        front->~T();
+        head_ = (head_ + 1) % capacity_;
+        --size_;
+        lock.unlock();
+        not_full_.notify_one();
+        f(value);
+        return true;
+    }
+
+    // 不再接受新记录，已入队的仍可以取出
+    void close() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            closed_ = true;
+        }
+        not_empty_.notify_all();
+        not_full_.notify_all();
+    }
+
+private:
+    typedef typename std::aligned_storage<sizeof(T), alignof(T)>::type slot;
+
+    T* at(size_t index) {
+        return reinterpret_cast<T*>(&slots_[index]);
+    }
+
+    std::unique_ptr<slot[]> slots_;
+    size_t capacity_;
+    size_t head_;
+    size_t size_;
+    bool closed_;
+
+    std::mutex mutex_;
+    std::condition_variable not_empty_;
+    std::condition_variable not_full_;
+};
+
+#endif
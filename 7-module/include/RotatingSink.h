@@ -0,0 +1,410 @@
+#ifndef ROTATING_SINK_H
+#define ROTATING_SINK_H
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <exception>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <fmt/core.h>
+#include "Sinks.h"
+#include "ThreadPool.h"
+
+// 按大小滚动的文本文件 sink：log 写满 max_size 后，最新的旧文件是 log.1，依次到 log.<max_files>。
+// 写入时只累加一个字节计数。滚动时在锁内只做三件事：写出缓冲并关闭、把当前文件改名为
+// log.pending.<pid>.<创建时间>.<序号>、重新打开 log；依次挪动 log.1 … log.<max_files> 的改名链交给后台线程
+// 按顺序执行，写日志的线程不必等待。pending 文件名带进程号和 sink 的创建时间，上次运行崩溃时留下的
+// pending 文件不会被覆盖。后台改名失败时由下一次 flush 抛出，之后的滚动照常进行。
+class rotating_file_sink : public base_sink {
+public:
+    rotating_file_sink(const std::string& filename, uint64_t max_size, size_t max_files,
+                       bool rotate_in_background = true)
+        : filename_(filename), max_size_(max_size), max_files_(max_files), current_size_(0), rotations_(0),
+          pending_prefix_(fmt::format("{}.pending.{}.{}.", filename, getpid(),
+                                      std::chrono::duration_cast<std::chrono::microseconds>(
+                                          std::chrono::system_clock::now().time_since_epoch()).count())),
+          background_(rotate_in_background ? new ThreadPool(1) : nullptr) {
+        if (max_size == 0) {
+            throw std::runtime_error("滚动文件的最大大小必须大于 0");
+        }
+        file_helper_.open(filename, false);
+        struct stat st;
+        if (stat(filename.c_str(), &st) == 0) {
+            current_size_ = static_cast<uint64_t>(st.st_size);
+        }
+    }
+
+    // 先等后台改名全部完成，再关闭文件
+    ~rotating_file_sink() {
+        background_.reset();
+    }
+
+    void log(const std::string& msg) override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        fmt::string_view line = checked_utf8(msg);
+        reserve(line.size());
+        file_helper_.write(line.data(), line.size());
+    }
+
+    bool fragments() const override { return true; }
+
+    void log_fragments(const fmt::string_view* parts, size_t count) override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        fmt::string_view line;
+        if (checked_utf8(parts, count, line)) {
+            parts = &line;
+            count = 1;
+        }
+        size_t size = 0;
+        for (size_t i = 0; i < count; ++i) {
+            size += parts[i].size();
+        }
+        reserve(size);
+        file_helper_.write_fragments(parts, count);
+    }
+
+    // 写出缓冲，并等待此前所有滚动的改名完成，之后各文件名与滚动次数一致
+    void flush() override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        file_helper_.flush();
+        std::vector<std::future<void>> pending;
+        pending.swap(pending_);
+        std::exception_ptr error;
+        error.swap(error_);
+        for (auto& rename : pending) {
+            try {
+                rename.get();
+            } catch (...) {
+                if (!error) {
+                    error = std::current_exception();
+                }
+            }
+        }
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+
+    uint64_t rotations() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return rotations_;
+    }
+
+    // log.<index>，index 为 0 时是当前文件
+    static std::string rotated_name(const std::string& filename, size_t index) {
+        return index == 0 ? filename : filename + "." + std::to_string(index);
+    }
+
+private:
+    // 一条记录不拆到两个文件里；单条超过 max_size 时独占一个文件
+    void reserve(size_t size) {
+        if (current_size_ + size > max_size_ && current_size_ > 0) {
+            rotate();
+        }
+        current_size_ += size;
+    }
+
+    void rotate() {
+        file_helper_.close();
+        std::string pending = pending_prefix_ + std::to_string(rotations_);
+        if (std::rename(filename_.c_str(), pending.c_str()) != 0) {
+            std::string reason = std::strerror(errno);
+            file_helper_.open(filename_, false);
+            throw std::runtime_error("滚动日志文件失败：" + reason);
+        }
+        file_helper_.open(filename_, true);
+        current_size_ = 0;
+        ++rotations_;
+        if (background_) {
+            // 先把这次的改名链交出去，pending 文件不会因为之前的失败而无人处理；
+            // 已完成的改名移出 pending_ 避免无限增长，失败留到 flush 时抛出，当前记录照常写入
+            pending_.push_back(background_->enqueue(&rotating_file_sink::shift_files, filename_, pending, max_files_));
+            for (auto it = pending_.begin(); it != pending_.end();) {
+                if (it->wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+                    ++it;
+                    continue;
+                }
+                try {
+                    it->get();
+                } catch (...) {
+                    if (!error_) {
+                        error_ = std::current_exception();
+                    }
+                }
+                it = pending_.erase(it);
+            }
+        } else {
+            try {
+                shift_files(filename_, pending, max_files_);
+            } catch (...) {
+                if (!error_) {
+                    error_ = std::current_exception();
+                }
+            }
+        }
+    }
+
+    // 删除 log.<max_files>，log.i 改名为 log.i+1，最后 pending 改名为 log.1
+    static void shift_files(const std::string& filename, const std::string& pending, size_t max_files) {
+        if (max_files == 0) {
+            std::remove(pending.c_str());
+            return;
+        }
+        std::remove(rotated_name(filename, max_files).c_str());
+        for (size_t i = max_files - 1; i >= 1; --i) {
+            std::string from = rotated_name(filename, i);
+            if (std::rename(from.c_str(), rotated_name(filename, i + 1).c_str()) != 0 && errno != ENOENT) {
+                throw std::runtime_error("滚动日志文件失败：" + from + "：" + std::strerror(errno));
+            }
+        }
+        if (std::rename(pending.c_str(), rotated_name(filename, 1).c_str()) != 0) {
+            throw std::runtime_error("滚动日志文件失败：" + pending + "：" + std::strerror(errno));
+        }
+    }
+
+    std::string filename_;
+    uint64_t max_size_;
+    size_t max_files_;
+    uint64_t current_size_;
+    uint64_t rotations_;
+    std::string pending_prefix_;
+    file_helper file_helper_;
+    std::vector<std::future<void>> pending_;  // 后台尚未确认的改名
+    std::exception_ptr error_;                // 失败的改名，留到 flush 时抛出
+    std::unique_ptr<ThreadPool> background_;  // 为空时在锁内同步改名
+
+    mutable std::mutex mutex_;
+};
+
+enum class rotation_period {
+    hourly,  // app_2026-10-16_13.log
+    daily    // app_2026-10-16.log
+};
+
+// 按时间切分的文本文件 sink：app.log 按记录所在的本地日期（和小时）写到 app_2026-10-16.log 这样的文件里。
+// 切换时刻只在打开新文件时用 mktime 算一次，之后每条消息只把 Logger 交来的记录时间与它做一次整数比较，
+// 不读时钟也不做日期转换。记录时间在进入锁之前取得，跨越切换时刻的几条记录可能落在相邻文件里。
+// max_files 大于 0 时只保留最新的 max_files 个文件（包括以前运行留下的），
+// 删除在后台线程扫描目录完成；失败时由下一次 flush 抛出
+class timed_file_sink : public base_sink {
+public:
+    timed_file_sink(const std::string& filename, rotation_period period, size_t max_files = 0)
+        : filename_(filename), period_(period), max_files_(max_files), next_rotation_ns_(0),
+          cleanup_(max_files > 0 ? new ThreadPool(1) : nullptr) {
+        rotate(now_ns());
+    }
+
+    // 先等后台删除完成，再关闭文件
+    ~timed_file_sink() {
+        cleanup_.reset();
+    }
+
+    // 不经过 Logger 直接写入时没有记录时间，读一次系统时钟
+    void log(const std::string& msg) override {
+        fmt::string_view part = msg;
+        log_timed(&part, 1, now_ns());
+    }
+
+    bool fragments() const override { return true; }
+
+    void log_fragments(const fmt::string_view* parts, size_t count) override {
+        log_timed(parts, count, now_ns());
+    }
+
+    bool timed() const override { return true; }
+
+    void log_timed(const fmt::string_view* parts, size_t count, int64_t time_ns) override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (time_ns >= next_rotation_ns_) {
+            rotate(time_ns);
+        }
+        fmt::string_view line;
+        if (checked_utf8(parts, count, line)) {
+            file_helper_.write(line.data(), line.size());
+        } else {
+            file_helper_.write_fragments(parts, count);
+        }
+    }
+
+    // 写出缓冲，并等待此前发起的旧文件删除完成；删除失败在这里抛出
+    void flush() override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        file_helper_.flush();
+        std::vector<std::future<void>> pending;
+        pending.swap(pending_);
+        std::exception_ptr error;
+        error.swap(error_);
+        for (auto& cleanup : pending) {
+            try {
+                cleanup.get();
+            } catch (...) {
+                if (!error) {
+                    error = std::current_exception();
+                }
+            }
+        }
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+
+    // 当前写入的文件名
+    std::string current_file() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return current_file_;
+    }
+
+    // app.log 在 time_ns 所在时段的文件名
+    static std::string dated_name(const std::string& filename, rotation_period period, int64_t time_ns) {
+        std::time_t seconds = static_cast<std::time_t>(floor_div(time_ns, 1000000000));
+        std::tm local;
+        localtime_r(&seconds, &local);
+        return dated_name(filename, period, local);
+    }
+
+private:
+    static int64_t now_ns() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::system_clock::now().time_since_epoch()).count();
+    }
+
+    static int64_t floor_div(int64_t value, int64_t divisor) {
+        return value / divisor - (value % divisor < 0 ? 1 : 0);
+    }
+
+    // 扩展名从最后一个路径分隔符之后的最后一个点算起，没有扩展名时日期直接接在末尾
+    static size_t extension_pos(const std::string& filename) {
+        size_t slash = filename.rfind('/');
+        size_t dot = filename.rfind('.');
+        return dot == std::string::npos || (slash != std::string::npos && dot < slash) || dot == slash + 1
+                   ? filename.size()
+                   : dot;
+    }
+
+    static std::string dated_name(const std::string& filename, rotation_period period, const std::tm& local) {
+        size_t ext = extension_pos(filename);
+        char date[32];
+        if (period == rotation_period::daily) {
+            std::snprintf(date, sizeof(date), "_%04d-%02d-%02d", local.tm_year + 1900, local.tm_mon + 1, local.tm_mday);
+        } else {
+            std::snprintf(date, sizeof(date), "_%04d-%02d-%02d_%02d", local.tm_year + 1900, local.tm_mon + 1,
+                          local.tm_mday, local.tm_hour);
+        }
+        return filename.substr(0, ext) + date + filename.substr(ext);
+    }
+
+    // 打开 time_ns 所在时段的文件，并算出下一个切换时刻。
+    // 用 mktime 规整下一天或下一小时，夏令时切换当天的长度也由它处理
+    void rotate(int64_t time_ns) {
+        std::time_t seconds = static_cast<std::time_t>(floor_div(time_ns, 1000000000));
+        std::tm local;
+        localtime_r(&seconds, &local);
+        std::string name = dated_name(filename_, period_, local);
+        if (name != current_file_) {
+            file_helper_.close();
+            file_helper_.open(name, false);
+            current_file_ = name;
+        }
+        std::tm next = local;
+        next.tm_sec = 0;
+        next.tm_min = 0;
+        if (period_ == rotation_period::daily) {
+            next.tm_hour = 0;
+            ++next.tm_mday;
+        } else {
+            ++next.tm_hour;
+        }
+        next.tm_isdst = -1;
+        std::time_t next_seconds = std::mktime(&next);
+        // 夏令时回拨时下一小时可能算回到同一时刻，至少向前推进一秒
+        next_rotation_ns_ = static_cast<int64_t>(std::max(next_seconds, seconds + 1)) * 1000000000;
+        if (cleanup_) {
+            // 先交出这次的删除，再把已完成的移出 pending_；失败留到 flush 时抛出，当前记录照常写入
+            pending_.push_back(cleanup_->enqueue(&timed_file_sink::remove_old_files, filename_, period_, max_files_));
+            for (auto it = pending_.begin(); it != pending_.end();) {
+                if (it->wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+                    ++it;
+                    continue;
+                }
+                try {
+                    it->get();
+                } catch (...) {
+                    if (!error_) {
+                        error_ = std::current_exception();
+                    }
+                }
+                it = pending_.erase(it);
+            }
+        }
+    }
+
+    // 目录里形如 app_YYYY-MM-DD[_HH].log 的文件按名字排序即按时间排序，删除最新 max_files 个之外的
+    static void remove_old_files(const std::string& filename, rotation_period period, size_t max_files) {
+        size_t slash = filename.rfind('/');
+        std::string dir = slash == std::string::npos ? "." : filename.substr(0, slash + 1);
+        size_t ext = extension_pos(filename);
+        size_t stem_begin = slash == std::string::npos ? 0 : slash + 1;
+        std::string prefix = filename.substr(stem_begin, ext - stem_begin) + "_";
+        std::string suffix = filename.substr(ext);
+        const char* pattern = period == rotation_period::daily ? "dddd-dd-dd" : "dddd-dd-dd_dd";
+        size_t date_size = std::strlen(pattern);
+
+        DIR* handle = opendir(dir.c_str());
+        if (!handle) {
+            throw std::runtime_error("无法读取日志目录：" + dir + "：" + std::strerror(errno));
+        }
+        std::vector<std::string> files;
+        while (dirent* entry = readdir(handle)) {
+            std::string name = entry->d_name;
+            if (name.size() != prefix.size() + date_size + suffix.size() || name.compare(0, prefix.size(), prefix) != 0 ||
+                name.compare(name.size() - suffix.size(), suffix.size(), suffix) != 0) {
+                continue;
+            }
+            bool match = true;
+            for (size_t i = 0; i < date_size && match; ++i) {
+                char c = name[prefix.size() + i];
+                match = pattern[i] == 'd' ? (c >= '0' && c <= '9') : c == pattern[i];
+            }
+            if (match) {
+                files.push_back(name);
+            }
+        }
+        closedir(handle);
+        if (files.size() <= max_files) {
+            return;
+        }
+        std::sort(files.begin(), files.end());
+        for (size_t i = 0; i + max_files < files.size(); ++i) {
+            std::string path = slash == std::string::npos ? files[i] : dir + files[i];
+            if (std::remove(path.c_str()) != 0 && errno != ENOENT) {
+                throw std::runtime_error("删除旧日志文件失败：" + path + "：" + std::strerror(errno));
+            }
+        }
+    }
+
+    std::string filename_;
+    rotation_period period_;
+    size_t max_files_;
+    std::string current_file_;
+    int64_t next_rotation_ns_;  // 当前文件所在时段的结束时刻，自 epoch 起的纳秒数
+    file_helper file_helper_;
+    std::vector<std::future<void>> pending_;  // 后台尚未确认的删除
+    std::exception_ptr error_;                // 失败的删除，留到 flush 时抛出
+    std::unique_ptr<ThreadPool> cleanup_;     // 为空时不删除旧文件
+
+    mutable std::mutex mutex_;
+};
+
+#endif
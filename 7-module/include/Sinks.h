@@ -0,0 +1,497 @@
+#ifndef SINKS_H
+#define SINKS_H
+
+#include <atomic>
+#include <cerrno>
+#include <climits>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <fmt/core.h>
+#include "Escape.h"
+#include "LogFields.h"
+#include "Utf8.h"
+
+// 直接基于文件描述符的文件写入：数据先攒在用户态缓冲里，满了或 flush 时才 write(2)，
+// 不经过 iostream 的 locale、sentry 和 streambuf 的虚函数。
+// 以 O_APPEND 打开，每次 write 都落在文件末尾；被信号打断和部分写入时继续写完剩余部分
+class file_helper {
+public:
+    static const size_t default_buffer_size = 64 * 1024;
+
+    explicit file_helper(size_t buffer_size = default_buffer_size)
+        : fd_(-1), buffer_size_(buffer_size), used_(0), writeback_chunk_(0), offset_(0), submitted_(0),
+          dropped_(0) {}
+
+    file_helper(const file_helper&) = delete;
+    file_helper& operator=(const file_helper&) = delete;
+
+    void open(const std::string& filename, bool truncate = false) {
+        close();
+        int flags = O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC | (truncate ? O_TRUNC : 0);
+        int fd;
+        do {
+            fd = ::open(filename.c_str(), flags, 0644);
+        } while (fd < 0 && errno == EINTR);
+        if (fd < 0) {
+            throw std::runtime_error("无法打开文件：" + filename + "：" + std::strerror(errno));
+        }
+        fd_ = fd;
+        if (buffer_size_ > 0 && !buffer_) {
+            buffer_.reset(new char[buffer_size_]);
+        }
+        // 已有的内容不回写也不丢弃，从当前末尾开始计
+        off_t end = lseek(fd, 0, SEEK_END);
+        offset_ = end > 0 ? static_cast<uint64_t>(end) : 0;
+        submitted_ = offset_;
+        dropped_ = offset_;
+    }
+
+    // 日志文件只写一次，留在页缓存里只会挤掉应用的热数据，攒到最后又集中回写。
+    // 打开后每写满 chunk 字节就用 sync_file_range 发起这一块的回写，同时等上一块回写完成，
+    // 再用 POSIX_FADV_DONTNEED 从页缓存里丢掉它：脏页和缓存页都不超过约两块。
+    // 磁盘跟不上时写入在这里等待，而不是积累大量脏页后被内核集中限速。
+    // 0 表示关闭；文件系统或文件类型不支持时自动关闭
+    void set_writeback(size_t chunk) {
+        writeback_chunk_ = chunk;
+        submitted_ = offset_;
+        dropped_ = offset_;
+    }
+
+    size_t writeback() const {
+        return writeback_chunk_;
+    }
+
+    // 先写出已缓冲的数据再调整大小，0 表示不缓冲，每次 write 直接写入
+    void set_buffer_size(size_t size) {
+        if (fd_ >= 0) {
+            flush();
+        }
+        buffer_size_ = size;
+        buffer_.reset(size > 0 ? new char[size] : nullptr);
+    }
+
+    size_t buffer_size() const {
+        return buffer_size_;
+    }
+
+    // 底层文件描述符，未打开时为 -1；只用于 fdatasync 这类不改变写入位置的调用
+    int fd() const {
+        return fd_;
+    }
+
+    void write(const std::string& msg) {
+        write(msg.data(), msg.size());
+    }
+
+    // 放不进剩余空间时先写出缓冲；不小于整个缓冲的数据不再拷贝，直接写入
+    void write(const char* data, size_t size) {
+        if (fd_ < 0) {
+            throw std::runtime_error("文件未打开");
+        }
+        if (size == 0) {
+            return;
+        }
+        if (used_ + size > buffer_size_) {
+            flush_buffer();
+            if (size >= buffer_size_) {
+                write_fully(data, size);
+                return;
+            }
+        }
+        std::memcpy(buffer_.get() + used_, data, size);
+        used_ += size;
+    }
+
+    // 一条记录由多个片段组成（时间、级别、线程、正文）。整条放得进缓冲时照常拷贝，
+    // 多条小记录攒成一次 write；放不下时不再拼接，已缓冲的数据和各片段一起 writev 写出
+    void write_fragments(const fmt::string_view* parts, size_t count) {
+        if (fd_ < 0) {
+            throw std::runtime_error("文件未打开");
+        }
+        size_t total = 0;
+        for (size_t i = 0; i < count; ++i) {
+            total += parts[i].size();
+        }
+        if (used_ + total <= buffer_size_) {
+            for (size_t i = 0; i < count; ++i) {
+                std::memcpy(buffer_.get() + used_, parts[i].data(), parts[i].size());
+                used_ += parts[i].size();
+            }
+            return;
+        }
+        iov_.clear();
+        if (used_ > 0) {
+            iov_.push_back(iovec{buffer_.get(), used_});
+        }
+        for (size_t i = 0; i < count; ++i) {
+            if (parts[i].size() > 0) {
+                iov_.push_back(iovec{const_cast<char*>(parts[i].data()), parts[i].size()});
+            }
+        }
+        used_ = 0;
+        writev_fully(iov_.data(), iov_.size());
+    }
+
+    void flush() {
+        if (fd_ < 0) {
+            throw std::runtime_error("文件未打开");
+        }
+        flush_buffer();
+    }
+
+    void close() {
+        if (fd_ >= 0) {
+            int fd = fd_;
+            try {
+                flush_buffer();
+            } catch (...) {
+                fd_ = -1;
+                used_ = 0;
+                ::close(fd);
+                throw;
+            }
+            fd_ = -1;
+            ::close(fd);
+        }
+    }
+
+    ~file_helper() {
+        try {
+            close();
+        } catch (const std::exception&) {
+            // 析构时无处报告写入失败，丢弃未写出的数据
+        }
+    }
+
+private:
+    void flush_buffer() {
+        size_t used = used_;
+        used_ = 0;
+        write_fully(buffer_.get(), used);
+    }
+
+    void write_fully(const char* data, size_t size) {
+        while (size > 0) {
+            ssize_t written = ::write(fd_, data, size);
+            if (written < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                throw std::runtime_error(std::string("写入文件失败：") + std::strerror(errno));
+            }
+            data += written;
+            size -= static_cast<size_t>(written);
+            offset_ += static_cast<uint64_t>(written);
+        }
+        start_writeback();
+    }
+
+    // 按块推进：发起新写满的一块的回写，等上一块写完后从页缓存丢掉
+    void start_writeback() {
+#ifdef SYNC_FILE_RANGE_WRITE
+        while (writeback_chunk_ > 0 && offset_ - submitted_ >= writeback_chunk_) {
+            uint64_t begin = submitted_;
+            if (sync_file_range(fd_, static_cast<off64_t>(begin), static_cast<off64_t>(writeback_chunk_),
+                                SYNC_FILE_RANGE_WRITE) != 0) {
+                writeback_failed();
+                return;
+            }
+            submitted_ = begin + writeback_chunk_;
+            if (dropped_ < begin) {
+                off64_t size = static_cast<off64_t>(begin - dropped_);
+                if (sync_file_range(fd_, static_cast<off64_t>(dropped_), size,
+                                    SYNC_FILE_RANGE_WAIT_BEFORE | SYNC_FILE_RANGE_WRITE |
+                                        SYNC_FILE_RANGE_WAIT_AFTER) != 0) {
+                    writeback_failed();
+                    return;
+                }
+                posix_fadvise(fd_, static_cast<off_t>(dropped_), static_cast<off_t>(size), POSIX_FADV_DONTNEED);
+                dropped_ = begin;
+            }
+        }
+#endif
+    }
+
+    // 管道、不支持的文件系统等情况下关闭回写；真正的 I/O 错误照常报告
+    void writeback_failed() {
+        int err = errno;
+        if (err == ESPIPE || err == EINVAL || err == ENOSYS || err == EOPNOTSUPP) {
+            writeback_chunk_ = 0;
+            return;
+        }
+        throw std::runtime_error(std::string("回写文件失败：") + std::strerror(err));
+    }
+
+    // 每批最多 IOV_MAX 个片段，部分写入时从写到一半的片段继续
+    void writev_fully(iovec* iov, size_t count) {
+        while (count > 0) {
+            int batch = static_cast<int>(count < IOV_MAX ? count : IOV_MAX);
+            ssize_t written = ::writev(fd_, iov, batch);
+            if (written < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                throw std::runtime_error(std::string("写入文件失败：") + std::strerror(errno));
+            }
+            offset_ += static_cast<uint64_t>(written);
+            size_t remaining = static_cast<size_t>(written);
+            while (count > 0 && remaining >= iov->iov_len) {
+                remaining -= iov->iov_len;
+                ++iov;
+                --count;
+            }
+            if (remaining > 0) {
+                iov->iov_base = static_cast<char*>(iov->iov_base) + remaining;
+                iov->iov_len -= remaining;
+            }
+        }
+        start_writeback();
+    }
+
+    int fd_;
+    size_t buffer_size_;
+    size_t used_;
+    std::unique_ptr<char[]> buffer_;
+    std::vector<iovec> iov_;
+    size_t writeback_chunk_;
+    uint64_t offset_;     // 本进程写到的文件末尾
+    uint64_t submitted_;  // 此前已发起回写
+    uint64_t dropped_;    // 此前已回写完成并从页缓存丢掉
+};
+
+// 交给结构化 sink 的完整记录，只在 log_packed 调用期间有效。
+// 二进制 sink 直接写出 ArgPack 形式的参数，其他结构化 sink 使用类型擦除的参数自行格式化
+struct packed_record {
+    uint32_t site_id;            // 调用点 id，0 表示动态格式串
+    int level;
+    fmt::string_view level_name;
+    fmt::string_view logger_name;  // 指向驻留字符串，未命名时为空
+    fmt::string_view format;
+    const char* file;            // 调用点元数据，site_id 为 0 时为 nullptr
+    int line;
+    const char* signature;
+    int64_t time_ns;             // 自 epoch 起的纳秒数
+    uint32_t tid;
+    fmt::string_view thread_label; // 指向驻留字符串，同一线程改名前指针不变
+    fmt::format_args format_args;
+    field_view fields;
+    fmt::string_view args;         // ArgPack 打包的参数，仅 binary() 为 true 时提供
+    fmt::string_view packed_fields; // 打包的字段，仅 binary() 为 true 时提供
+};
+
+class base_sink {
+public:
+    virtual ~base_sink() = default;
+
+    virtual void log(const std::string& msg) = 0;
+    virtual void flush() = 0;
+
+    // 结构化 sink 接收完整记录而不是格式化好的文本，Logger 对它们跳过文本格式化；
+    // 二进制 sink 另外需要打包好的参数
+    virtual bool structured() const { return false; }
+    virtual bool binary() const { return false; }
+    virtual void log_packed(const packed_record&) {}
+
+    // 支持分片的文本 sink 直接接收日志头和正文的各个片段，Logger 不再把它们拼成一行；
+    // 片段只在调用期间有效
+    virtual bool fragments() const { return false; }
+    virtual void log_fragments(const fmt::string_view* parts, size_t count) {
+        std::string line;
+        for (size_t i = 0; i < count; ++i) {
+            line.append(parts[i].data(), parts[i].size());
+        }
+        log(line);
+    }
+
+    // 按时间切分文件的 sink 需要记录自身的时间戳，Logger 把已经算好的时间一并交给它，
+    // sink 不必为每条消息再读一次时钟
+    virtual bool timed() const { return false; }
+    virtual void log_timed(const fmt::string_view* parts, size_t count, int64_t /*time_ns*/) {
+        log_fragments(parts, count);
+    }
+
+    // 调用方依赖“日志调用返回时记录已交给 sink”的 sink（例如落盘确认的票据），
+    // 不能挂到异步 logger 上，AsyncLogger::add_sink 会拒绝
+    virtual bool synchronous() const { return false; }
+
+    // sink 自己的级别过滤，取值与 Logger::LogLevel 相同，默认全部接收
+    void set_level(int level) {
+        level_.store(level, std::memory_order_relaxed);
+    }
+
+    bool should_log(int level) const {
+        return level >= level_.load(std::memory_order_relaxed);
+    }
+
+    // 按写入量触发 flush：距上次触发累计 bytes 字节或 records 条记录后由 Logger 调用一次 flush，
+    // 0 表示不按该项触发。字节数按文本行计算，结构化 sink 只按条数计
+    void set_flush_threshold(uint64_t bytes, uint64_t records) {
+        flush_bytes_.store(bytes, std::memory_order_relaxed);
+        flush_records_.store(records, std::memory_order_relaxed);
+    }
+
+    // Logger 每写入一条记录调用一次，返回 true 表示达到阈值、应当 flush。
+    // 多个 Logger 共用同一个 sink 时计数并发累加，触发点可能相差几条
+    bool count_written(size_t bytes) {
+        uint64_t max_bytes = flush_bytes_.load(std::memory_order_relaxed);
+        uint64_t max_records = flush_records_.load(std::memory_order_relaxed);
+        if (max_bytes == 0 && max_records == 0) {
+            return false;
+        }
+        uint64_t written = unflushed_bytes_.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+        uint64_t records = unflushed_records_.fetch_add(1, std::memory_order_relaxed) + 1;
+        if ((max_bytes != 0 && written >= max_bytes) || (max_records != 0 && records >= max_records)) {
+            unflushed_bytes_.store(0, std::memory_order_relaxed);
+            unflushed_records_.store(0, std::memory_order_relaxed);
+            return true;
+        }
+        return false;
+    }
+
+    // 打开后每行写出前校验 UTF-8，不合法的字节序列替换为 U+FFFD，
+    // 避免下游收集端因为一行脏数据拒收整批日志
+    void set_utf8_repair(bool enabled) {
+        utf8_repair_.store(enabled, std::memory_order_relaxed);
+    }
+
+    bool utf8_repair() const {
+        return utf8_repair_.load(std::memory_order_relaxed);
+    }
+
+protected:
+    base_sink()
+        : level_(0), utf8_repair_(false), flush_bytes_(0), flush_records_(0), unflushed_bytes_(0),
+          unflushed_records_(0) {}
+
+    // 在 sink 自己的锁内调用，返回的视图在下一次调用前有效
+    fmt::string_view checked_utf8(fmt::string_view data) {
+        return utf8_repair_.load(std::memory_order_relaxed) ? utf8_checked(data, utf8_buf_) : data;
+    }
+
+    // 分片版本：合法片段拼起来仍然合法，逐片校验都通过（或未打开修复）时返回 false，原样写出各片段；
+    // 否则拼进复用的成员缓冲再修复，line 指向修复后的整行。同样在 sink 自己的锁内调用
+    bool checked_utf8(const fmt::string_view* parts, size_t count, fmt::string_view& line) {
+        if (!utf8_repair_.load(std::memory_order_relaxed)) {
+            return false;
+        }
+        size_t i = 0;
+        while (i < count && utf8_validate(parts[i].data(), parts[i].size())) {
+            ++i;
+        }
+        if (i == count) {
+            return false;
+        }
+        utf8_join_.clear();
+        for (i = 0; i < count; ++i) {
+            utf8_join_.append(parts[i].data(), parts[i].data() + parts[i].size());
+        }
+        line = utf8_checked(fmt::string_view(utf8_join_.data(), utf8_join_.size()), utf8_buf_);
+        return true;
+    }
+
+private:
+    std::atomic<int> level_;
+    std::atomic<bool> utf8_repair_;
+    fmt::memory_buffer utf8_buf_;
+    fmt::memory_buffer utf8_join_;
+    std::atomic<uint64_t> flush_bytes_;
+    std::atomic<uint64_t> flush_records_;
+    std::atomic<uint64_t> unflushed_bytes_;
+    std::atomic<uint64_t> unflushed_records_;
+};
+
+class ansicolor_sink : public base_sink {
+public:
+    ansicolor_sink(FILE* file) : file_(file), escape_control_(false) {}
+
+    // 打开后消息里的控制字符按 \xNN 转义后输出，只保留行尾换行，
+    // 避免不可信字符串伪造日志行或向终端注入控制序列
+    void set_escape_control(bool enabled) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        escape_control_ = enabled;
+    }
+
+    void log(const std::string& msg) override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        fmt::string_view line = msg;
+        if (escape_control_) {
+            size_t size = !msg.empty() && msg.back() == '\n' ? msg.size() - 1 : msg.size();
+            buf_.clear();
+            escape_control(buf_, fmt::string_view(msg.data(), size));
+            buf_.append(msg.data() + size, msg.data() + msg.size());
+            line = fmt::string_view(buf_.data(), buf_.size());
+        }
+        line = checked_utf8(line);
+        fwrite(line.data(), 1, line.size(), file_);
+    }
+
+    void flush() override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        fflush(file_);
+    }
+
+
+private:
+    FILE* file_;
+    bool escape_control_;
+    fmt::memory_buffer buf_;
+
+    std::mutex mutex_;
+};
+
+class file_sink : public base_sink {
+public:
+    file_sink(const std::string& filename, size_t buffer_size = file_helper::default_buffer_size)
+        : filename_(filename), file_helper_(buffer_size) {
+        file_helper_.open(filename, false);
+    }
+
+    void log(const std::string& msg) override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        fmt::string_view line = checked_utf8(msg);
+        file_helper_.write(line.data(), line.size());
+    }
+
+    bool fragments() const override { return true; }
+
+    // 需要修复 UTF-8 时才写拼好的整行
+    void log_fragments(const fmt::string_view* parts, size_t count) override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        fmt::string_view line;
+        if (checked_utf8(parts, count, line)) {
+            file_helper_.write(line.data(), line.size());
+        } else {
+            file_helper_.write_fragments(parts, count);
+        }
+    }
+
+    // 每写满 chunk 字节发起回写并把已落盘的部分移出页缓存，见 file_helper::set_writeback
+    void set_writeback(size_t chunk) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        file_helper_.set_writeback(chunk);
+    }
+
+    void flush() override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        file_helper_.flush();
+    }
+
+
+
+private:
+    std::string filename_;
+    file_helper file_helper_;
+
+    std::mutex mutex_;
+};
+
+#endif
@@ -0,0 +1,58 @@
+#ifndef THREAD_INFO_H
+#define THREAD_INFO_H
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_set>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <fmt/format.h>
+
+// 线程字段按渲染后的样子（"[tid] " 或 "[tid:name] "）预先拼好，
+// 驻留在全局表里永不释放。日志记录只保存指针，渲染时整段拷贝，
+// 线程退出后异步记录仍可安全引用。表故意泄漏而不是函数内的静态对象：
+// 注册在 Registry 里的异步 logger 在静态析构阶段才停下工作线程，那时仍在渲染这些字段
+inline const std::string* intern_thread_field(uint32_t tid, const std::string& name) {
+    static std::mutex* mutex = new std::mutex;
+    static std::unordered_set<std::string>* fields = new std::unordered_set<std::string>;
+    std::string field = "[" + fmt::format_int(tid).str();
+    if (!name.empty()) {
+        field += ':';
+        field += name;
+    }
+    field += "] ";
+    std::lock_guard<std::mutex> lock(*mutex);
+    return &*fields->insert(field).first;
+}
+
+// 去掉方括号和空格后的标签，供二进制格式保存
+inline fmt::string_view thread_label(const std::string* field) {
+    return fmt::string_view(field->data() + 1, field->size() - 3);
+}
+
+// 常量初始化的线程局部变量，访问时没有 TLS 包装函数和初始化守卫
+struct thread_info {
+    constexpr thread_info() : tid(0), field(nullptr) {}
+
+    uint32_t tid;
+    std::atomic<const std::string*> field;
+};
+
+inline thread_info& this_thread_info() {
+    static thread_local thread_info info;
+    if (info.field.load(std::memory_order_relaxed) == nullptr) {
+        info.tid = static_cast<uint32_t>(::syscall(SYS_gettid));
+        info.field.store(intern_thread_field(info.tid, std::string()), std::memory_order_relaxed);
+    }
+    return info;
+}
+
+// 为当前线程设置名称，之后的日志行显示为 "[tid:name]"
+inline void set_thread_name(const std::string& name) {
+    thread_info& info = this_thread_info();
+    info.field.store(intern_thread_field(info.tid, name), std::memory_order_relaxed);
+}
+
+#endif
@@ -35,6 +35,7 @@ private:
     // synchronization
     std::mutex queue_mutex;
     std::condition_variable condition;
+    std::condition_variable space_available; // 队列满时阻塞的生产者在这里等待
     bool stop;
     
     // overflow policy
@@ -63,6 +64,7 @@ inline ThreadPool::ThreadPool(size_t threads, size_t maxQueueSize, async_overflo
                         task = std::move(this->tasks.front());
                         this->tasks.pop();
                     }
+                    this->space_available.notify_one();
 
                     task();
                 }
@@ -92,8 +94,10 @@ auto ThreadPool::enqueue(F&& f, Args&&... args)
         if(tasks.size() >= maxQueueSize) {
             switch (overflow_policy) {
                 case async_overflow_policy::block:
-                    // 阻塞直到有空间
-                    condition.wait(lock, [this]{ return tasks.size() < maxQueueSize; });
+                    // 阻塞直到有空间；等待期间线程池可能已经析构，工作线程退出后不会再取任务
+                    space_available.wait(lock, [this]{ return stop || tasks.size() < maxQueueSize; });
+                    if(stop)
+                        throw std::runtime_error("enqueue on stopped ThreadPool");
                     break;
                 case async_overflow_policy::overrun_oldest:
                     // 溢出最旧的任务
@@ -119,6 +123,7 @@ inline ThreadPool::~ThreadPool()
         stop = true;
     }
     condition.notify_all();
+    space_available.notify_all();
     for(std::thread &worker: workers)
         worker.join();
 }
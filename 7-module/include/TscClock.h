@@ -0,0 +1,257 @@
+#ifndef TSC_CLOCK_H
+#define TSC_CLOCK_H
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#include <x86intrin.h>
+#endif
+
+// 时间戳来源：生产者只读取原始刻度，转换为墙上时间的工作留给消费者线程
+enum class clock_source {
+    realtime,      // CLOCK_REALTIME，刻度即纳秒
+    monotonic_raw, // CLOCK_MONOTONIC_RAW，需要校准到墙上时间
+    tsc            // rdtsc，需要校准到墙上时间
+};
+
+inline int64_t clock_ns(clockid_t id) {
+    timespec ts;
+    clock_gettime(id, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+// 只有 invariant TSC（频率恒定、深度睡眠不停）才能当作时钟使用
+inline bool tsc_available() {
+#if defined(__x86_64__) || defined(__i386__)
+    unsigned eax, ebx, ecx, edx;
+    if (!__get_cpuid(0x80000000, &eax, &ebx, &ecx, &edx) || eax < 0x80000007) {
+        return false;
+    }
+    __get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx);
+    return (edx & (1u << 8)) != 0;
+#else
+    return false;
+#endif
+}
+
+// 不支持 TSC 时退回 CLOCK_MONOTONIC_RAW
+inline clock_source resolve_clock_source(clock_source source) {
+    static const bool has_tsc = tsc_available();
+    return source == clock_source::tsc && !has_tsc ? clock_source::monotonic_raw : source;
+}
+
+inline uint64_t capture_ticks(clock_source source) {
+    switch (source) {
+#if defined(__x86_64__) || defined(__i386__)
+        case clock_source::tsc: return __rdtsc();
+#endif
+        case clock_source::monotonic_raw: return clock_ns(CLOCK_MONOTONIC_RAW);
+        default: return clock_ns(CLOCK_REALTIME);
+    }
+}
+
+// 把原始刻度换算为自 epoch 起的纳秒数。
+// 每个时钟维护一段线性映射，记录超过锚点 refresh_ns 后重新对照 CLOCK_REALTIME 校准；
+// 落后的误差通过调整斜率在下一个周期内追平，不会回跳，保证映射单调。
+// 斜率使用自首次校准以来的最长基线估计，误差在微秒级以内。
+// 首次校准（忙等约 10ms）只做一次；之后换算不拿锁：映射以 seqlock 发布，读者读到一致的快照即可，
+// 到期的刷新由抢到 refresh_mutex 的一个线程完成，其余线程继续用当前映射
+class tick_converter {
+public:
+    static tick_converter& instance() {
+        static tick_converter converter;
+        return converter;
+    }
+
+    int64_t to_realtime_ns(clock_source source, uint64_t ticks) {
+        if (source == clock_source::realtime) {
+            return static_cast<int64_t>(ticks);
+        }
+        calibration& c = calibrations_[source == clock_source::tsc ? 0 : 1];
+        if (!c.initialized.load(std::memory_order_acquire)) {
+            std::call_once(c.once, [&] { initialize(c, source); });
+        }
+        mapping m = c.published.load();
+        if (ticks > m.anchor_ticks && ticks - m.anchor_ticks > m.refresh_ticks) {
+            std::unique_lock<std::mutex> lock(c.refresh_mutex, std::try_to_lock);
+            if (lock.owns_lock()) {
+                m = c.published.load();
+                if (ticks > m.anchor_ticks && ticks - m.anchor_ticks > m.refresh_ticks) {
+                    refresh(c, source, m);
+                }
+            }
+        }
+        const segment& seg = ticks >= m.current.ticks ? m.current : m.previous;
+        double delta = static_cast<double>(static_cast<int64_t>(ticks - seg.ticks));
+        return seg.ns + static_cast<int64_t>(delta * seg.ns_per_tick);
+    }
+
+    static const int64_t refresh_ns = 1000000000;
+
+private:
+    struct segment {
+        uint64_t ticks;
+        int64_t ns;
+        double ns_per_tick;
+    };
+
+    // 读者需要的全部状态
+    struct mapping {
+        uint64_t anchor_ticks;   // 最近一次校准
+        uint64_t refresh_ticks;
+        segment current;
+        segment previous;
+    };
+
+    // seqlock：写者把序号改成奇数、写字段、再改回偶数；读者在前后序号相同且为偶数时才采用读到的值。
+    // 字段都是 relaxed 原子量，读写并发时不构成数据竞争
+    class published_mapping {
+    public:
+        published_mapping() : seq_(0) {
+            store(mapping{0, 0, segment{0, 0, 1.0}, segment{0, 0, 1.0}});
+        }
+
+        mapping load() const {
+            for (;;) {
+                uint32_t before = seq_.load(std::memory_order_acquire);
+                mapping m;
+                m.anchor_ticks = anchor_ticks_.load(std::memory_order_relaxed);
+                m.refresh_ticks = refresh_ticks_.load(std::memory_order_relaxed);
+                load_segment(current_, m.current);
+                load_segment(previous_, m.previous);
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (!(before & 1) && seq_.load(std::memory_order_relaxed) == before) {
+                    return m;
+                }
+            }
+        }
+
+        // 写者之间由调用方串行化
+        void store(const mapping& m) {
+            uint32_t seq = seq_.load(std::memory_order_relaxed);
+            seq_.store(seq + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            anchor_ticks_.store(m.anchor_ticks, std::memory_order_relaxed);
+            refresh_ticks_.store(m.refresh_ticks, std::memory_order_relaxed);
+            store_segment(current_, m.current);
+            store_segment(previous_, m.previous);
+            seq_.store(seq + 2, std::memory_order_release);
+        }
+
+    private:
+        struct atomic_segment {
+            std::atomic<uint64_t> ticks;
+            std::atomic<int64_t> ns;
+            std::atomic<double> ns_per_tick;
+        };
+
+        static void load_segment(const atomic_segment& from, segment& to) {
+            to.ticks = from.ticks.load(std::memory_order_relaxed);
+            to.ns = from.ns.load(std::memory_order_relaxed);
+            to.ns_per_tick = from.ns_per_tick.load(std::memory_order_relaxed);
+        }
+
+        static void store_segment(atomic_segment& to, const segment& from) {
+            to.ticks.store(from.ticks, std::memory_order_relaxed);
+            to.ns.store(from.ns, std::memory_order_relaxed);
+            to.ns_per_tick.store(from.ns_per_tick, std::memory_order_relaxed);
+        }
+
+        std::atomic<uint32_t> seq_;
+        std::atomic<uint64_t> anchor_ticks_;
+        std::atomic<uint64_t> refresh_ticks_;
+        atomic_segment current_;
+        atomic_segment previous_;
+    };
+
+    struct calibration {
+        std::atomic<bool> initialized{false};
+        std::once_flag once;
+        std::mutex refresh_mutex;     // 串行化刷新，换算本身不拿它
+        uint64_t base_ticks = 0;      // 首次校准的基线，之后只读
+        int64_t base_ns = 0;
+        published_mapping published;
+    };
+
+    struct clock_sample {
+        uint64_t ticks;
+        int64_t ns;
+    };
+
+    // 读取刻度与墙上时间的配对，取三次中间隔最短的一次
+    static clock_sample sample(clock_source source) {
+        clock_sample result = {0, 0};
+        uint64_t best = UINT64_MAX;
+        for (int i = 0; i < 3; ++i) {
+            uint64_t before = capture_ticks(source);
+            int64_t now = clock_ns(CLOCK_REALTIME);
+            uint64_t after = capture_ticks(source);
+            if (after - before < best) {
+                best = after - before;
+                result.ticks = before + (after - before) / 2;
+                result.ns = now;
+            }
+        }
+        return result;
+    }
+
+    static double ns_per_tick(const calibration& c, const clock_sample& now) {
+        return static_cast<double>(now.ns - c.base_ns) / static_cast<double>(now.ticks - c.base_ticks);
+    }
+
+    // 只在 call_once 中运行一次
+    void initialize(calibration& c, clock_source source) {
+        clock_sample base = sample(source);
+        c.base_ticks = base.ticks;
+        c.base_ns = base.ns;
+        // 首次校准忙等 10ms 得到初始频率，之后每次刷新都会用更长的基线修正
+        clock_sample now;
+        do {
+            now = sample(source);
+        } while (now.ns - c.base_ns < 10000000);
+        double slope = ns_per_tick(c, now);
+        mapping m;
+        m.anchor_ticks = now.ticks;
+        m.refresh_ticks = static_cast<uint64_t>(refresh_ns / slope);
+        m.current = segment{now.ticks, now.ns, slope};
+        m.previous = m.current;
+        c.published.store(m);
+        c.initialized.store(true, std::memory_order_release);
+    }
+
+    // 需要持有 c.refresh_mutex；m 是当前发布的映射，刷新后更新为新发布的映射
+    void refresh(calibration& c, clock_source source, mapping& m) {
+        clock_sample now = sample(source);
+        double slope = ns_per_tick(c, now);
+
+        const segment& old = m.current;
+        int64_t mapped = old.ns + static_cast<int64_t>(static_cast<double>(now.ticks - old.ticks) * old.ns_per_tick);
+        int64_t error = now.ns - mapped;
+        segment next;
+        next.ticks = now.ticks;
+        if (error >= 0) {
+            // 映射落后于墙上时间：直接向前跳，单调性不受影响
+            next.ns = now.ns;
+            next.ns_per_tick = slope;
+        } else {
+            // 映射超前：从当前位置出发放慢斜率，在一个周期内消化误差
+            next.ns = mapped;
+            double scale = static_cast<double>(refresh_ns + error) / refresh_ns;
+            next.ns_per_tick = slope * (scale < 0.5 ? 0.5 : scale);
+        }
+        m.previous = m.current;
+        m.current = next;
+        m.anchor_ticks = now.ticks;
+        m.refresh_ticks = static_cast<uint64_t>(refresh_ns / slope);
+        c.published.store(m);
+    }
+
+    tick_converter() = default;
+
+    calibration calibrations_[2];
+};
+
+#endif
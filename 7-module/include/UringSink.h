@@ -0,0 +1,370 @@
+#ifndef URING_SINK_H
+#define URING_SINK_H
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <fmt/core.h>
+#include "Sinks.h"
+
+// 通过 io_uring 提交文件写入（直接系统调用，不依赖 liburing）。
+// 数据先拷贝进若干个固定大小的缓冲，写满的缓冲整块提交后立即换下一个继续写，
+// 完成后回收复用；只有所有缓冲都在途时才等待完成，磁盘慢时格式化不必停在 write 上。
+class uring_writer {
+public:
+    uring_writer() : ring_fd_(-1), sq_ptr_(MAP_FAILED), cq_ptr_(MAP_FAILED), sqes_(nullptr),
+                     sq_size_(0), cq_size_(0), sqes_size_(0) {}
+
+    uring_writer(const uring_writer&) = delete;
+    uring_writer& operator=(const uring_writer&) = delete;
+
+    ~uring_writer() {
+        close();
+    }
+
+    // 内核不支持、被禁用（如 seccomp）或缺少 IORING_OP_WRITE 时返回 false，调用方退回 write(2)
+    bool open(unsigned entries) {
+        io_uring_params params;
+        std::memset(&params, 0, sizeof(params));
+        int fd = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+        if (fd < 0) {
+            return false;
+        }
+        ring_fd_ = fd;
+        // IORING_OP_WRITE 与 IORING_FEAT_RW_CUR_POS 同在 5.6 引入，以后者判断内核版本
+        if (!(params.features & IORING_FEAT_RW_CUR_POS)) {
+            close();
+            return false;
+        }
+        sq_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cq_size_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        bool single = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+        if (single) {
+            sq_size_ = cq_size_ = sq_size_ > cq_size_ ? sq_size_ : cq_size_;
+        }
+        sq_ptr_ = mmap(nullptr, sq_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+        cq_ptr_ = single ? sq_ptr_
+                         : mmap(nullptr, cq_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd,
+                                IORING_OFF_CQ_RING);
+        sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+        void* sqes = mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd,
+                          IORING_OFF_SQES);
+        if (sq_ptr_ == MAP_FAILED || cq_ptr_ == MAP_FAILED || sqes == MAP_FAILED) {
+            if (sqes != MAP_FAILED) {
+                munmap(sqes, sqes_size_);
+            }
+            close();
+            return false;
+        }
+        sqes_ = static_cast<io_uring_sqe*>(sqes);
+        char* sq = static_cast<char*>(sq_ptr_);
+        sq_tail_ = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+        sq_mask_ = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+        sq_array_ = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+        char* cq = static_cast<char*>(cq_ptr_);
+        cq_head_ = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+        cq_tail_ = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+        cq_mask_ = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+        cqes_ = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+        return true;
+    }
+
+    void close() {
+        if (sqes_) {
+            munmap(sqes_, sqes_size_);
+            sqes_ = nullptr;
+        }
+        if (cq_ptr_ != MAP_FAILED && cq_ptr_ != sq_ptr_) {
+            munmap(cq_ptr_, cq_size_);
+        }
+        if (sq_ptr_ != MAP_FAILED) {
+            munmap(sq_ptr_, sq_size_);
+        }
+        sq_ptr_ = cq_ptr_ = MAP_FAILED;
+        if (ring_fd_ >= 0) {
+            ::close(ring_fd_);
+            ring_fd_ = -1;
+        }
+    }
+
+    // 排入一次 pwrite 并立即提交，user_data 在完成时原样返回。
+    // 调用方保证在途请求数不超过队列长度
+    void submit_write(int fd, const char* data, size_t size, uint64_t offset, uint64_t user_data) {
+        unsigned tail = *sq_tail_;
+        unsigned index = tail & sq_mask_;
+        io_uring_sqe& sqe = sqes_[index];
+        std::memset(&sqe, 0, sizeof(sqe));
+        sqe.opcode = IORING_OP_WRITE;
+        sqe.fd = fd;
+        sqe.addr = reinterpret_cast<uint64_t>(data);
+        sqe.len = static_cast<uint32_t>(size);
+        sqe.off = offset;
+        sqe.user_data = user_data;
+        sq_array_[index] = index;
+        __atomic_store_n(sq_tail_, tail + 1, __ATOMIC_RELEASE);
+        enter(1, 0, 0);
+    }
+
+    // 取出一个完成事件，wait 为 true 时没有就阻塞等待
+    bool next_completion(uint64_t& user_data, int& result, bool wait) {
+        for (;;) {
+            unsigned head = *cq_head_;
+            if (head != __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE)) {
+                const io_uring_cqe& cqe = cqes_[head & cq_mask_];
+                user_data = cqe.user_data;
+                result = cqe.res;
+                __atomic_store_n(cq_head_, head + 1, __ATOMIC_RELEASE);
+                return true;
+            }
+            if (!wait) {
+                return false;
+            }
+            enter(0, 1, IORING_ENTER_GETEVENTS);
+        }
+    }
+
+private:
+    void enter(unsigned to_submit, unsigned min_complete, unsigned flags) {
+        for (;;) {
+            long ret = syscall(__NR_io_uring_enter, ring_fd_, to_submit, min_complete, flags, nullptr, 0);
+            if (ret >= 0) {
+                return;
+            }
+            if (errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+                throw std::runtime_error(std::string("io_uring 提交失败：") + std::strerror(errno));
+            }
+        }
+    }
+
+    int ring_fd_;
+    void* sq_ptr_;
+    void* cq_ptr_;
+    io_uring_sqe* sqes_;
+    size_t sq_size_;
+    size_t cq_size_;
+    size_t sqes_size_;
+    unsigned* sq_tail_;
+    unsigned sq_mask_;
+    unsigned* sq_array_;
+    unsigned* cq_head_;
+    unsigned* cq_tail_;
+    unsigned cq_mask_;
+    io_uring_cqe* cqes_;
+};
+
+// 文本文件 sink：io_uring 可用时用多个在途缓冲异步写入，否则退回 file_helper 的 write(2)。
+// 在途的写入可能乱序完成，所以不用 O_APPEND，而是自己维护偏移、每块按确定的位置写入，
+// 代价是多个进程同时追加同一个文件时不再安全
+class uring_file_sink : public base_sink {
+public:
+    static const size_t default_buffer_count = 4;
+    static const size_t default_buffer_size = 256 * 1024;
+
+    uring_file_sink(const std::string& filename, size_t buffer_count = default_buffer_count,
+                    size_t buffer_size = default_buffer_size, bool use_uring = true)
+        : filename_(filename), fd_(-1), buffer_size_(buffer_size), current_(0), next_offset_(0), error_(0),
+          fallback_(buffer_size) {
+        if (buffer_count == 0 || buffer_size == 0) {
+            throw std::runtime_error("io_uring sink 的缓冲数量和大小必须大于 0");
+        }
+        if (use_uring && ring_.open(static_cast<unsigned>(buffer_count))) {
+            open_file();
+            buffers_.resize(buffer_count);
+            for (auto& buffer : buffers_) {
+                buffer.data.reset(new char[buffer_size]);
+            }
+        } else {
+            fallback_.open(filename, false);
+        }
+    }
+
+    ~uring_file_sink() {
+        if (fd_ >= 0) {
+            try {
+                drain();
+            } catch (const std::exception&) {
+                // 析构时无处报告写入失败
+            }
+            ::close(fd_);
+        }
+    }
+
+    bool using_uring() const {
+        return fd_ >= 0;
+    }
+
+    void log(const std::string& msg) override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        fmt::string_view line = checked_utf8(msg);
+        append(line.data(), line.size());
+    }
+
+    bool fragments() const override { return true; }
+
+    void log_fragments(const fmt::string_view* parts, size_t count) override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        fmt::string_view line;
+        if (checked_utf8(parts, count, line)) {
+            parts = &line;
+            count = 1;
+        }
+        if (!using_uring()) {
+            fallback_.write_fragments(parts, count);
+            return;
+        }
+        for (size_t i = 0; i < count; ++i) {
+            append(parts[i].data(), parts[i].size());
+        }
+    }
+
+    // 提交当前缓冲并等待全部在途写入完成，之后数据与 write(2) 一样已进入页缓存
+    void flush() override {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!using_uring()) {
+            fallback_.flush();
+            return;
+        }
+        drain();
+    }
+
+private:
+    struct buffer {
+        buffer() : used(0), done(0), offset(0), in_flight(false) {}
+
+        std::unique_ptr<char[]> data;
+        size_t used;
+        size_t done;      // 已确认写入的字节数，部分写入时从这里继续
+        uint64_t offset;  // 在文件中的起始位置
+        bool in_flight;
+    };
+
+    void open_file() {
+        int fd;
+        do {
+            fd = ::open(filename_.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC, 0644);
+        } while (fd < 0 && errno == EINTR);
+        struct stat st;
+        if (fd < 0 || fstat(fd, &st) != 0) {
+            std::string reason = std::strerror(errno);
+            if (fd >= 0) {
+                ::close(fd);
+            }
+            throw std::runtime_error("无法打开文件：" + filename_ + "：" + reason);
+        }
+        fd_ = fd;
+        next_offset_ = static_cast<uint64_t>(st.st_size);
+    }
+
+    void append(const char* data, size_t size) {
+        if (!using_uring()) {
+            fallback_.write(data, size);
+            return;
+        }
+        check_error();
+        while (size > 0) {
+            buffer& current = buffers_[current_];
+            size_t n = buffer_size_ - current.used < size ? buffer_size_ - current.used : size;
+            std::memcpy(current.data.get() + current.used, data, n);
+            current.used += n;
+            data += n;
+            size -= n;
+            if (current.used == buffer_size_) {
+                submit_current();
+            }
+        }
+    }
+
+    // 提交当前缓冲并换到下一个，下一个仍在途时先等它完成
+    void submit_current() {
+        buffer& current = buffers_[current_];
+        if (current.used == 0) {
+            return;
+        }
+        current.offset = next_offset_;
+        current.done = 0;
+        current.in_flight = true;
+        next_offset_ += current.used;
+        ring_.submit_write(fd_, current.data.get(), current.used, current.offset, current_);
+        current_ = (current_ + 1) % buffers_.size();
+        reap(false);
+        while (buffers_[current_].in_flight) {
+            reap(true);
+        }
+        check_error();
+    }
+
+    void reap(bool wait) {
+        uint64_t index;
+        int result;
+        while (ring_.next_completion(index, result, wait)) {
+            complete(buffers_[index], index, result);
+            wait = false;
+        }
+    }
+
+    // 部分写入和 EINTR/EAGAIN 从已写位置重新提交；其他错误记下来，由下一次调用抛出
+    void complete(buffer& done, uint64_t index, int result) {
+        if (result < 0 && result != -EINTR && result != -EAGAIN) {
+            if (error_ == 0) {
+                error_ = -result;
+            }
+        } else {
+            done.done += result > 0 ? static_cast<size_t>(result) : 0;
+            if (done.done < done.used) {
+                ring_.submit_write(fd_, done.data.get() + done.done, done.used - done.done, done.offset + done.done,
+                                   index);
+                return;
+            }
+        }
+        done.in_flight = false;
+        done.used = 0;
+    }
+
+    void drain() {
+        submit_current();
+        for (;;) {
+            bool in_flight = false;
+            for (const auto& buffer : buffers_) {
+                in_flight = in_flight || buffer.in_flight;
+            }
+            if (!in_flight) {
+                break;
+            }
+            reap(true);
+        }
+        check_error();
+    }
+
+    void check_error() {
+        if (error_ != 0) {
+            int error = error_;
+            error_ = 0;
+            throw std::runtime_error(std::string("写入文件失败：") + std::strerror(error));
+        }
+    }
+
+    std::string filename_;
+    int fd_;                      // io_uring 不可用时为 -1，改用 fallback_
+    size_t buffer_size_;
+    std::vector<buffer> buffers_;
+    size_t current_;
+    uint64_t next_offset_;
+    int error_;
+    uring_writer ring_;
+    file_helper fallback_;
+
+    std::mutex mutex_;
+};
+
+#endif
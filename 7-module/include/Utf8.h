@@ -0,0 +1,289 @@
+#ifndef UTF8_H
+#define UTF8_H
+
+#include <cstddef>
+#include <cstring>
+#include <fmt/format.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+// UTF-8 校验与修复。
+// 校验先用 SIMD 判断整段是否合法（Keiser & Lemire 的查表法，16/32 字节一组），
+// 绝大多数日志行合法，直接原样使用；只有不合法的行才逐字节修复，
+// 每个不合法的最长子序列替换为一个 U+FFFD（Unicode 推荐做法）。
+
+typedef bool (*utf8_validate_fn)(const char*, size_t);
+
+// 从 p 开始解码一个字符，size 为合法序列的长度或需要替换的不合法子序列长度（至少 1）
+inline bool utf8_sequence(const unsigned char* p, const unsigned char* end, size_t& size) {
+    unsigned char c = *p;
+    if (c < 0x80) {
+        size = 1;
+        return true;
+    }
+    size_t length;
+    unsigned char low = 0x80, high = 0xbf;  // 第二个字节的合法范围
+    if (c >= 0xc2 && c <= 0xdf) {
+        length = 2;
+    } else if (c >= 0xe0 && c <= 0xef) {
+        length = 3;
+        if (c == 0xe0) low = 0xa0;        // 过长编码
+        if (c == 0xed) high = 0x9f;       // 代理区
+    } else if (c >= 0xf0 && c <= 0xf4) {
+        length = 4;
+        if (c == 0xf0) low = 0x90;        // 过长编码
+        if (c == 0xf4) high = 0x8f;       // 超出 U+10FFFF
+    } else {
+        size = 1;
+        return false;
+    }
+    for (size_t i = 1; i < length; ++i) {
+        if (p + i == end || p[i] < (i == 1 ? low : 0x80) || p[i] > (i == 1 ? high : 0xbf)) {
+            size = i;
+            return false;
+        }
+    }
+    size = length;
+    return true;
+}
+
+inline bool utf8_validate_scalar(const char* data, size_t size) {
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(data);
+    const unsigned char* end = p + size;
+    while (p != end) {
+        size_t n;
+        if (!utf8_sequence(p, end, n)) {
+            return false;
+        }
+        p += n;
+    }
+    return true;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+// 查表法：用前一字节的高/低 4 位和当前字节的高 4 位各查一张表，三者按位与得到
+// 两字节组合的错误类别；三、四字节序列的后续字节另外用前 2/3 个字节判断
+namespace utf8_detail {
+
+enum : unsigned char {
+    too_short = 1 << 0,       // 前导字节后面缺少后续字节
+    too_long = 1 << 1,        // ASCII 后面跟着后续字节
+    overlong_3 = 1 << 2,
+    too_large = 1 << 3,
+    surrogate = 1 << 4,
+    overlong_2 = 1 << 5,
+    too_large_1000 = 1 << 6,
+    overlong_4 = 1 << 6,
+    two_conts = 1 << 7,       // 两个后续字节相连，是否合法由三、四字节检查决定
+    carry = too_short | too_long | two_conts
+};
+
+#define UTF8_BYTE_1_HIGH \
+    too_long, too_long, too_long, too_long, too_long, too_long, too_long, too_long, \
+    two_conts, two_conts, two_conts, two_conts, \
+    too_short | overlong_2, too_short, too_short | overlong_3 | surrogate, \
+    too_short | too_large | too_large_1000 | overlong_4
+#define UTF8_BYTE_1_LOW \
+    carry | overlong_3 | overlong_2 | overlong_4, carry | overlong_2, carry, carry, \
+    carry | too_large, carry | too_large | too_large_1000, carry | too_large | too_large_1000, \
+    carry | too_large | too_large_1000, carry | too_large | too_large_1000, \
+    carry | too_large | too_large_1000, carry | too_large | too_large_1000, \
+    carry | too_large | too_large_1000, carry | too_large | too_large_1000, \
+    carry | too_large | too_large_1000 | surrogate, carry | too_large | too_large_1000, \
+    carry | too_large | too_large_1000
+#define UTF8_BYTE_2_HIGH \
+    too_short, too_short, too_short, too_short, too_short, too_short, too_short, too_short, \
+    too_long | overlong_2 | two_conts | overlong_3 | too_large_1000 | overlong_4, \
+    too_long | overlong_2 | two_conts | overlong_3 | too_large, \
+    too_long | overlong_2 | two_conts | surrogate | too_large, \
+    too_long | overlong_2 | two_conts | surrogate | too_large, \
+    too_short, too_short, too_short, too_short
+// 块末尾 3 个字节若是多字节序列的前导字节，序列必然延续到下一块
+#define UTF8_INCOMPLETE_MAX(n) \
+    n == 1 ? 0xc0 - 1 : n == 2 ? 0xe0 - 1 : n == 3 ? 0xf0 - 1 : 0xff
+
+// 跨块携带的状态：累计的错误、上一块的输入、上一块末尾未完成的序列
+struct block_state_ssse3 {
+    __m128i error;
+    __m128i prev_input;
+    __m128i prev_incomplete;
+    __m128i incomplete_max;
+};
+
+struct block_state_avx2 {
+    __m256i error;
+    __m256i prev_input;
+    __m256i prev_incomplete;
+    __m256i incomplete_max;
+};
+
+__attribute__((target("ssse3")))
+inline __m128i check_block_ssse3(__m128i input, __m128i prev_input) {
+    const __m128i byte_1_high = _mm_setr_epi8(UTF8_BYTE_1_HIGH);
+    const __m128i byte_1_low = _mm_setr_epi8(UTF8_BYTE_1_LOW);
+    const __m128i byte_2_high = _mm_setr_epi8(UTF8_BYTE_2_HIGH);
+    const __m128i nibble = _mm_set1_epi8(0x0f);
+    __m128i prev1 = _mm_alignr_epi8(input, prev_input, 15);
+    __m128i special = _mm_and_si128(
+        _mm_and_si128(_mm_shuffle_epi8(byte_1_high, _mm_and_si128(_mm_srli_epi16(prev1, 4), nibble)),
+                      _mm_shuffle_epi8(byte_1_low, _mm_and_si128(prev1, nibble))),
+        _mm_shuffle_epi8(byte_2_high, _mm_and_si128(_mm_srli_epi16(input, 4), nibble)));
+    __m128i prev2 = _mm_alignr_epi8(input, prev_input, 14);
+    __m128i prev3 = _mm_alignr_epi8(input, prev_input, 13);
+    __m128i must23 = _mm_or_si128(_mm_subs_epu8(prev2, _mm_set1_epi8(static_cast<char>(0xe0 - 0x80))),
+                                  _mm_subs_epu8(prev3, _mm_set1_epi8(static_cast<char>(0xf0 - 0x80))));
+    return _mm_xor_si128(_mm_and_si128(must23, _mm_set1_epi8(static_cast<char>(0x80))), special);
+}
+
+__attribute__((target("ssse3")))
+inline void step_ssse3(block_state_ssse3& state, __m128i input) {
+    if (_mm_movemask_epi8(input) == 0) {
+        state.error = _mm_or_si128(state.error, state.prev_incomplete);
+        state.prev_incomplete = _mm_setzero_si128();
+    } else {
+        state.error = _mm_or_si128(state.error, check_block_ssse3(input, state.prev_input));
+        state.prev_incomplete = _mm_subs_epu8(input, state.incomplete_max);
+    }
+    state.prev_input = input;
+}
+
+__attribute__((target("ssse3")))
+inline bool validate_ssse3(const char* data, size_t size) {
+    const __m128i incomplete_max = _mm_setr_epi8(
+        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+        static_cast<char>(UTF8_INCOMPLETE_MAX(3)), static_cast<char>(UTF8_INCOMPLETE_MAX(2)),
+        static_cast<char>(UTF8_INCOMPLETE_MAX(1)));
+    block_state_ssse3 state = {_mm_setzero_si128(), _mm_setzero_si128(), _mm_setzero_si128(), incomplete_max};
+    size_t i = 0;
+    for (; size - i >= 16; i += 16) {
+        step_ssse3(state, _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i)));
+    }
+    // 末尾不足一块时补零，未完成的序列会被识别为 too_short
+    char tail[16] = {0};
+    std::memcpy(tail, data + i, size - i);
+    step_ssse3(state, _mm_loadu_si128(reinterpret_cast<const __m128i*>(tail)));
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(state.error, _mm_setzero_si128())) == 0xffff;
+}
+
+template <int N>
+__attribute__((target("avx2")))
+inline __m256i prev_avx2(__m256i input, __m256i prev_input) {
+    return _mm256_alignr_epi8(input, _mm256_permute2x128_si256(prev_input, input, 0x21), 16 - N);
+}
+
+__attribute__((target("avx2")))
+inline __m256i check_block_avx2(__m256i input, __m256i prev_input) {
+    const __m256i byte_1_high = _mm256_setr_epi8(UTF8_BYTE_1_HIGH, UTF8_BYTE_1_HIGH);
+    const __m256i byte_1_low = _mm256_setr_epi8(UTF8_BYTE_1_LOW, UTF8_BYTE_1_LOW);
+    const __m256i byte_2_high = _mm256_setr_epi8(UTF8_BYTE_2_HIGH, UTF8_BYTE_2_HIGH);
+    const __m256i nibble = _mm256_set1_epi8(0x0f);
+    __m256i prev1 = prev_avx2<1>(input, prev_input);
+    __m256i special = _mm256_and_si256(
+        _mm256_and_si256(_mm256_shuffle_epi8(byte_1_high, _mm256_and_si256(_mm256_srli_epi16(prev1, 4), nibble)),
+                         _mm256_shuffle_epi8(byte_1_low, _mm256_and_si256(prev1, nibble))),
+        _mm256_shuffle_epi8(byte_2_high, _mm256_and_si256(_mm256_srli_epi16(input, 4), nibble)));
+    __m256i prev2 = prev_avx2<2>(input, prev_input);
+    __m256i prev3 = prev_avx2<3>(input, prev_input);
+    __m256i must23 = _mm256_or_si256(_mm256_subs_epu8(prev2, _mm256_set1_epi8(static_cast<char>(0xe0 - 0x80))),
+                                     _mm256_subs_epu8(prev3, _mm256_set1_epi8(static_cast<char>(0xf0 - 0x80))));
+    return _mm256_xor_si256(_mm256_and_si256(must23, _mm256_set1_epi8(static_cast<char>(0x80))), special);
+}
+
+__attribute__((target("avx2")))
+inline void step_avx2(block_state_avx2& state, __m256i input) {
+    if (_mm256_movemask_epi8(input) == 0) {
+        state.error = _mm256_or_si256(state.error, state.prev_incomplete);
+        state.prev_incomplete = _mm256_setzero_si256();
+    } else {
+        state.error = _mm256_or_si256(state.error, check_block_avx2(input, state.prev_input));
+        state.prev_incomplete = _mm256_subs_epu8(input, state.incomplete_max);
+    }
+    state.prev_input = input;
+}
+
+__attribute__((target("avx2")))
+inline bool validate_avx2(const char* data, size_t size) {
+    const __m256i incomplete_max = _mm256_setr_epi8(
+        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+        static_cast<char>(UTF8_INCOMPLETE_MAX(3)), static_cast<char>(UTF8_INCOMPLETE_MAX(2)),
+        static_cast<char>(UTF8_INCOMPLETE_MAX(1)));
+    block_state_avx2 state = {_mm256_setzero_si256(), _mm256_setzero_si256(), _mm256_setzero_si256(), incomplete_max};
+    size_t i = 0;
+    for (; size - i >= 32; i += 32) {
+        step_avx2(state, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i)));
+    }
+    // 末尾不足一块时补零，未完成的序列会被识别为 too_short
+    char tail[32] = {0};
+    std::memcpy(tail, data + i, size - i);
+    step_avx2(state, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(tail)));
+    return _mm256_testz_si256(state.error, state.error) != 0;
+}
+
+#undef UTF8_BYTE_1_HIGH
+#undef UTF8_BYTE_1_LOW
+#undef UTF8_BYTE_2_HIGH
+#undef UTF8_INCOMPLETE_MAX
+
+} // namespace utf8_detail
+
+inline bool utf8_validate_ssse3(const char* data, size_t size) {
+    return utf8_detail::validate_ssse3(data, size);
+}
+
+inline bool utf8_validate_avx2(const char* data, size_t size) {
+    return utf8_detail::validate_avx2(data, size);
+}
+#endif
+
+inline utf8_validate_fn resolve_utf8_validate() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        return utf8_validate_avx2;
+    }
+    if (__builtin_cpu_supports("ssse3")) {
+        return utf8_validate_ssse3;
+    }
+#endif
+    return utf8_validate_scalar;
+}
+
+inline bool utf8_validate(const char* data, size_t size) {
+    static const utf8_validate_fn validate = resolve_utf8_validate();
+    return validate(data, size);
+}
+
+// 把 str 修复后追加到 buf：合法片段整段拷贝，每个不合法子序列写一个 U+FFFD
+template <typename Buffer>
+inline void utf8_repair(Buffer& buf, fmt::string_view str) {
+    static const char replacement[] = "\xef\xbf\xbd";
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(str.data());
+    const unsigned char* end = p + str.size();
+    const unsigned char* run = p;
+    while (p != end) {
+        size_t n;
+        if (utf8_sequence(p, end, n)) {
+            p += n;
+            continue;
+        }
+        buf.append(reinterpret_cast<const char*>(run), reinterpret_cast<const char*>(p));
+        buf.append(replacement, replacement + 3);
+        p += n;
+        run = p;
+    }
+    buf.append(reinterpret_cast<const char*>(run), reinterpret_cast<const char*>(end));
+}
+
+// 合法时返回 str 本身；否则修复到 scratch 并返回其内容
+inline fmt::string_view utf8_checked(fmt::string_view str, fmt::memory_buffer& scratch) {
+    if (utf8_validate(str.data(), str.size())) {
+        return str;
+    }
+    scratch.clear();
+    utf8_repair(scratch, str);
+    return fmt::string_view(scratch.data(), scratch.size());
+}
+
+#endif
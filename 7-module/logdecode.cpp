@@ -0,0 +1,46 @@
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include "include/BinaryLog.h"
+
+// 把 binary_file_sink 写出的二进制日志还原为文本
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        std::cerr << "用法: " << argv[0] << " <二进制日志文件> [输出文件]" << std::endl;
+        return 1;
+    }
+
+    try {
+        std::ifstream in(argv[1], std::ios::binary);
+        if (!in.is_open()) {
+            throw std::runtime_error(std::string("无法打开文件：") + argv[1]);
+        }
+        std::stringstream data;
+        data << in.rdbuf();
+
+        FILE* out = stdout;
+        if (argc > 2) {
+            out = std::fopen(argv[2], "wb");
+            if (!out) {
+                throw std::runtime_error(std::string("无法打开文件：") + argv[2]);
+            }
+        }
+
+        binary_log_reader reader(data.str());
+        std::string line;
+        while (reader.next(line)) {
+            std::fwrite(line.data(), 1, line.size(), out);
+        }
+
+        if (out != stdout) {
+            std::fclose(out);
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "解码失败: " << e.what() << std::endl;
+        return -1;
+    }
+
+    return 0;
+}